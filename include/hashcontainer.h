@@ -1,8 +1,26 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <cstring>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <limits>
 #include <memory>
+#include <ostream>
+#include <set>
+#include <utility>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <xmmintrin.h>
+#endif
 
 //! @short The HashContainer template defines a fixed size container to store hashes.
 //! This class acts as a replacement for unordered containers provided by the STL.
@@ -24,6 +42,17 @@ public:
 	using sizeLimits = std::numeric_limits<sizeType>;
 	using hashLimits = std::numeric_limits<hashType>;
 
+	//! @short Defines how many buckets a hash can be stored in.
+	enum BucketChoice : uint8_t
+	{
+		//! Every hash belongs to exactly one bucket.
+		SingleChoice = 0,
+		//! Every hash has two candidate buckets and is inserted into the one with the shorter chain.
+		//! This flattens the chain lengths at the cost of searching a second bucket on a miss.
+		//! A bucket holds hashes of both of its candidates, so find can return more values of other hashes.
+		TwoChoices = 1
+	};
+
 	//! @short The Bucket class is used as an index to access all Nodes that share a part of their hash.
 	struct Bucket
 	{
@@ -37,9 +66,80 @@ public:
 		sizeType next;
 	};
 
+	//! @short The SnapshotHeader precedes the raw bucket and node arrays inside a snapshot.
+	//! It is used to reject snapshots that were written by an incompatible container.
+	struct SnapshotHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t sizeTypeBytes;
+		uint32_t hashTypeBytes;
+		uint32_t flags;
+		uint32_t reserved;
+		uint64_t bucketCount;
+		uint64_t nodeCount;
+		uint64_t freeHead;
+		uint64_t allocatedCount;
+	};
+
+	//! @short An Entry pairs the internal hash of a Node with its value. It is used by exportSorted and to index long chains.
+	struct Entry
+	{
+		hashType hash;
+		sizeType value;
+
+		//! @short Orders entries like the nodes of a sorted chain.
+		bool operator<(const Entry &other) const
+		{
+			return hash != other.hash ? hash < other.hash : value < other.value;
+		}
+	};
+
+	//! @short The BucketTable stores all values in compressed sparse row format.
+	//! The values of bucket b are stored in values[offsets[b]] to values[offsets[b + 1] - 1].
+	struct BucketTable
+	{
+		std::vector<sizeType> offsets;
+		std::vector<sizeType> values;
+	};
+
+	//! @short A BucketRange describes the buckets from begin to end - 1. It is used to split a sweep over all buckets.
+	struct BucketRange
+	{
+		sizeType begin;
+		sizeType end;
+	};
+
+	//! @short The default executor of parallelForEach. It runs every task on its own thread and waits for all of them.
+	//! The first task runs on the calling thread.
+	struct ThreadExecutor
+	{
+		void operator()(std::vector<std::function<void()>> &tasks) const;
+	};
+
+	//! @short Number of buckets a container allocates for every entry.
+	//! It is possible to adjust the container performance by modifying this factor.
+	//! Increasing it beyond 2 only results in minor performance gains and reducing it
+	//! below 1 results in severe performance penalties.
+	static const size_t bucketFactor = 2;
+
+	//! @short The largest number of entries a container of this type can hold.
+	static const size_t maximumEntries = sizeLimits::max() / bucketFactor - 1;
+
+	//! @short Number of buckets that share an entry counter, see partitions.
+	static const sizeType occupancyBlockSize = 64;
+
 	//! @short Construct a HashContainer with a fixed size.
 	//! @param entries : Maximum number of entries the HashContainer can hold.
-	explicit GenericHashContainer(size_t entries);
+	//! @param choice : Number of candidate buckets of every hash.
+	explicit GenericHashContainer(size_t entries, BucketChoice choice = SingleChoice);
+
+	//! @short Construct a HashContainer with a fixed size and a custom number of buckets.
+	//! Fewer buckets save memory at the cost of longer chains. See bucketFactor.
+	//! @param entries : Maximum number of entries the HashContainer can hold.
+	//! @param buckets : Number of buckets. Must not be 0 unless entries is 0.
+	//! @param choice : Number of candidate buckets of every hash.
+	GenericHashContainer(size_t entries, size_t buckets, BucketChoice choice = SingleChoice);
 
 	//! @short Construct a copy of HashContainer instance.
 	//! @param other : The container to copy.
@@ -65,7 +165,7 @@ protected:
 	class AbstractIterator
 	{
 	public:
-		AbstractIterator(const GenericHashContainer &ptr, sizeType pos) : m_container(ptr), m_position(pos) {}
+		AbstractIterator(const GenericHashContainer &ptr, sizeType pos) : m_container(&ptr), m_position(pos) {}
 
 		//! @short Accessor for the value this Iterator points to.
 		sizeType operator*() const { return m_position; }
@@ -86,28 +186,38 @@ protected:
 		}
 
 	protected:
-		const GenericHashContainer<sizeType, hashType> &m_container;
+		const GenericHashContainer<sizeType, hashType> *m_container;
 		sizeType m_position;
 	};
 
 public:
 
 	//! @short This Iterator class is used to access All Element with the same hash.
-	//! This Iterator iterates therefore only over Nodes that are in the same Bucket.
+	//! This Iterator iterates therefore only over Nodes that are in the same Bucket, or in both candidate Buckets with TwoChoices.
+	//! It remembers the Node that links to the current one, so the current Node can be erased in constant time.
 	class SearchIterator : public AbstractIterator
 	{
 	public:
 		//! @short Construct an Iterator. Only used inside of the HashContainer.
 		//! @param ptr : The HashContainer this iterator points to.
 		//! @param pos : The position of the current Node the Iterator is pointing at.
-		SearchIterator(const GenericHashContainer &ptr, sizeType pos) : AbstractIterator(ptr, pos) {}
+		//! @param bucket : The Bucket the current Node belongs to.
+		//! @param previous : The position of the Node linking to the current Node or sizeLimits::max() when the Bucket links to it.
+		SearchIterator(const GenericHashContainer &ptr, sizeType pos, sizeType bucket, sizeType previous)
+			: AbstractIterator(ptr, pos), m_bucket(bucket), m_previous(previous) {}
 
 		//! @short Pre-increment to access the next value with the same hash as the current.
 		SearchIterator& operator++()
 		{
-			AbstractIterator::m_position = AbstractIterator::m_container.findNext(AbstractIterator::m_position);
+			AbstractIterator::m_position = AbstractIterator::m_container->nextMatch(AbstractIterator::m_position, m_bucket, m_previous);
 			return *this;
 		}
+
+	protected:
+		friend class GenericHashContainer;
+
+		sizeType m_bucket;
+		sizeType m_previous;
 	};
 
 	//! @short Iterator that is used to access every entry in an order of the associated hash.
@@ -118,7 +228,7 @@ public:
 
 		Iterator& operator++()
 		{
-			AbstractIterator::m_position = AbstractIterator::m_container.nextElement(AbstractIterator::m_position, m_bucket);
+			AbstractIterator::m_position = AbstractIterator::m_container->nextElement(AbstractIterator::m_position, m_bucket);
 			return *this;
 		}
 
@@ -145,26 +255,220 @@ public:
 		}
 	};
 
+	//! @short SearchIterator that prefetches the nodes it visits next.
+	//! Every node of a chain is only known after its predecessor was loaded, so the prefetches can only run ahead
+	//! of the nodes this Iterator has visited. They hide the latency when the caller does enough work for every value.
+	class PrefetchingSearchIterator : public SearchIterator
+	{
+	public:
+		//! @short Construct an Iterator that continues where another one points to.
+		//! @param it : The SearchIterator to start at.
+		//! @param distance : Number of nodes the prefetches run ahead of this Iterator.
+		PrefetchingSearchIterator(const SearchIterator &it, sizeType distance = chainPrefetchDistance)
+			: SearchIterator(it), m_distance(distance)
+		{
+			restart();
+		}
+
+		//! @short Pre-increment to access the next value with the same hash as the current.
+		PrefetchingSearchIterator& operator++()
+		{
+			const sizeType bucket = SearchIterator::m_bucket;
+			SearchIterator::operator++();
+			if (SearchIterator::m_bucket != bucket)
+			{
+				// The search continues in the second candidate bucket, where the prefetches have to start again.
+				restart();
+			}
+			else if (m_ahead != sizeLimits::max())
+			{
+				m_ahead = AbstractIterator::m_container->prefetchNext(m_ahead, m_hash);
+			}
+			return *this;
+		}
+
+	protected:
+		void restart()
+		{
+			m_ahead = AbstractIterator::m_position;
+			if (m_ahead == sizeLimits::max())
+			{
+				return;
+			}
+
+			m_hash = AbstractIterator::m_container->m_nodeList[m_ahead].hash;
+			for (sizeType step = 0; step < m_distance && m_ahead != sizeLimits::max(); ++step)
+			{
+				m_ahead = AbstractIterator::m_container->prefetchNext(m_ahead, m_hash);
+			}
+		}
+
+		sizeType m_distance;
+		sizeType m_ahead;
+		hashType m_hash;
+	};
+
+	//! @short Iterator that prefetches the first nodes of upcoming buckets and the next node of the current chain.
+	class PrefetchingIterator : public Iterator
+	{
+	public:
+		//! @short Construct an Iterator that continues where another one points to.
+		//! @param it : The Iterator to start at.
+		//! @param distance : Number of buckets whose first nodes are prefetched ahead of this Iterator.
+		PrefetchingIterator(const Iterator &it, sizeType distance = bucketPrefetchDistance)
+			: Iterator(it), m_distance(distance), m_ahead(Iterator::m_bucket)
+		{
+			if (AbstractIterator::m_position != sizeLimits::max())
+			{
+				AbstractIterator::m_container->prefetchBuckets(m_ahead, static_cast<size_t>(m_ahead) + m_distance);
+			}
+		}
+
+		PrefetchingIterator& operator++()
+		{
+			const sizeType bucket = Iterator::m_bucket;
+			Iterator::operator++();
+			if (AbstractIterator::m_position == sizeLimits::max())
+			{
+				return *this;
+			}
+
+			if (Iterator::m_bucket != bucket)
+			{
+				// Buckets that were skipped because they are empty need no prefetch.
+				m_ahead = std::max(m_ahead, Iterator::m_bucket);
+				AbstractIterator::m_container->prefetchBuckets(m_ahead, static_cast<size_t>(Iterator::m_bucket) + m_distance);
+			}
+			else
+			{
+				// The next increment reads this node to find its successor.
+				prefetchAddress(&AbstractIterator::m_container->m_nodeList[AbstractIterator::m_position]);
+			}
+			return *this;
+		}
+
+	protected:
+		sizeType m_distance;
+		sizeType m_ahead;
+	};
+
 	//! @short Inserts a hash value pair into this container. This might invalidate every Iterator.
 	//! @param hash : The hash to insert into this container. Not necessary unique.
 	//! @param value : The value associated with the hash. Must be unique for every entry and smaller than the container size.
 	//! Calling insert with a value already in use will invalidate the container.
+	//! Chains are kept sorted by the internal hash, so searches can stop at the first larger hash.
+	//! Nodes with the same internal hash stay adjacent inside their chain and are sorted by value, so find returns them in ascending order.
 	void insert(size_t hash, sizeType value) const;
 
+	//! @short Inserts a hash into this container and chooses an unused value for it. This might invalidate every Iterator.
+	//! Unused values are kept in a free list that is threaded through the unused nodes, so this takes constant time.
+	//! Do not mix this function with insert(hash, value) on the same container.
+	//! @param hash : The hash to insert into this container. Not necessary unique.
+	//! @return __value__ associated with the hash.
+	//! @return __sizeLimits::max()__ when every value is in use.
+	sizeType insert(size_t hash) const;
+
 	//! @short Removes a hash value pair from this container. This might invalidate every Iterator.
 	//! When the hash value pair can not be found nothing will happen.
+	//! A value that was chosen by insert(hash) can be chosen again afterwards.
 	//! @param hash : The hash to insert into this container.
 	//! @param value : The value associated with the hash. 
 	void remove(size_t hash, sizeType value) const;
 
+	//! @short Removes the hash value pair an Iterator points to in constant time. This might invalidate every other Iterator.
+	//! @param it : A valid Iterator returned by find, findIf, findOrInsert or erase of this container.
+	//! @return __Iterator__ to the next value with the same hash as the removed one, which is invalid when there is none.
+	SearchIterator erase(SearchIterator it) const;
+
+	//! @short Removes every value that satisfies a predicate in one sweep over all buckets. This might invalidate every Iterator.
+	//! @param pred : Callable that receives a value and returns __true__ when it should be removed.
+	//! @return Number of removed values.
+	template<class Predicate>
+	size_t removeIf(Predicate pred) const;
+
+	//! @short Removes every value that does not satisfy a predicate in one sweep over all buckets. This might invalidate every Iterator.
+	//! @param pred : Callable that receives a value and returns __true__ when it should be kept.
+	//! @return Number of removed values.
+	template<class Predicate>
+	size_t retainIf(Predicate pred) const;
+
+	//! @short Removes many hash value pairs. This might invalidate every Iterator.
+	//! The pairs are sorted by bucket first, so every affected chain is walked only once.
+	//! Pairs that can not be found are ignored.
+	//! @param first, last : Range of std::pair<size_t, sizeType> containing the hash and the value to remove.
+	//! @return Number of removed values.
+	template<class InputIt>
+	size_t removeBatch(InputIt first, InputIt last) const;
+
 	//! @short Removes the content but does not change its size.
 	void clear() const;
 
+	//! @short Renumbers all values so they occupy the range from 0 to the number of entries - 1. This invalidates every Iterator.
+	//! The relative order of the values is kept and nodes that were emplaced but not inserted are discarded.
+	//! When insert(hash) was used, the values that follow are chosen next.
+	//! @return Vector that maps every old value to its new value, or to sizeLimits::max() when it was not in use.
+	std::vector<sizeType> compact() const;
+
+	//! @short Renumbers all values so the nodes of every chain are adjacent and the chains follow the order of the buckets.
+	//! Afterwards an Iterator visits the values in ascending order. This invalidates every Iterator.
+	//! Like compact, the values occupy the range from 0 to the number of entries - 1 afterwards.
+	//! @return Vector that maps every old value to its new value, or to sizeLimits::max() when it was not in use.
+	std::vector<sizeType> reorderForLocality() const;
+
+	//! @short Enables or disables moving found entries to the front of their chain.
+	//! In this mode find and findIf move the found entry together with all entries of the same hash to the
+	//! front of the chain, so frequently searched hashes are found first. Searches no longer stop at the first
+	//! larger hash, because the chains are not sorted anymore. Disabling the mode sorts all chains again.
+	//! Because searches modify the chains in this mode, they must not run concurrently.
+	//! @param enabled : __True__ to enable the mode.
+	//! @param interval : Only every interval-th search that does not find the entry at the front moves it, to limit the number of writes.
+	void setSelfOrganizing(bool enabled, uint32_t interval = 1) const;
+
+	//! @short Returns __true__ when found entries are moved to the front of their chain.
+	bool selfOrganizing() const;
+
+	//! @short Issues non-blocking prefetches for the bucket of a hash and the first node of its chain.
+	//! Call this some time before searching, inserting or removing the hash to overlap the memory accesses with other work.
+	//! With TwoChoices both candidate buckets are prefetched.
+	//! @remark The first node is only known after the bucket was read, so it is prefetched from the current bucket content.
+	void prefetch(size_t hash) const;
+
+	//! @short Issues a non-blocking prefetch for the node of a value.
+	void prefetchNode(sizeType value) const;
+
 	//! @short Searches for a specific hash and returns an Iterator.
 	//! @return __valid Iterator__ when the hash is found.
 	//! @return __invalid Iterator__ when the hash wasn't found.
 	SearchIterator find(size_t hash) const;
 
+	//! @short Searches for a specific hash and returns an Iterator to the first value that satisfies a predicate.
+	//! Use this to compare the full keys, since only a part of the hash is stored inside the container.
+	//! The next node of the chain is prefetched while the predicate is evaluated.
+	//! @param hash : The hash to search for.
+	//! @param pred : Callable that receives a value and returns __true__ when it is the searched entry.
+	//! @return __valid Iterator__ when a matching value is found. Incrementing it continues with the next value with the same hash regardless of pred.
+	//! @return __invalid Iterator__ when no value matches.
+	template<class Predicate>
+	SearchIterator findIf(size_t hash, Predicate pred) const;
+
+	//! @short Searches for a value like findIf and inserts the hash value pair when none matches. This might invalidate every Iterator.
+	//! The chain is only walked once, so this is faster than findIf followed by insert.
+	//! @param hash : The hash to search for and to insert.
+	//! @param value : The value to insert when no value matches. See insert(hash, value).
+	//! @param pred : Callable that receives a value and returns __true__ when it is the searched entry.
+	//! @return __Iterator to the matching value__ and __false__ when a value matches.
+	//! @return __Iterator to value__ and __true__ when the hash value pair was inserted.
+	template<class Predicate>
+	std::pair<SearchIterator, bool> findOrInsert(size_t hash, sizeType value, Predicate pred) const;
+
+	//! @short Searches for a value like findIf and inserts the hash with an unused value when none matches. This might invalidate every Iterator.
+	//! See insert(hash) for how the value is chosen.
+	//! @return __Iterator to the matching value__ and __false__ when a value matches.
+	//! @return __Iterator to the chosen value__ and __true__ when the hash was inserted.
+	//! @return __invalid Iterator__ and __false__ when no value matches and every value is in use.
+	template<class Predicate>
+	std::pair<SearchIterator, bool> findOrInsert(size_t hash, Predicate pred) const;
+
 	//! @short Returns a (global) Iterator that can be used to iterate
 	//! over all nodes in an order defined by the associated hash.
 	Iterator begin() const;
@@ -182,6 +486,56 @@ public:
 	//! @remark Do not dereference this Iterator.
 	LocalIterator localEnd() const;
 
+	//! @short Calls a visitor for every value in the same order as an Iterator would.
+	//! The loop runs internally and prefetches the chains of upcoming buckets, which makes it faster than the Iterator.
+	//! @param visitor : Callable that receives a value. It must not modify this container.
+	template<class Visitor>
+	void forEach(Visitor visitor) const;
+
+	//! @short Calls a visitor for every bucket that is not empty.
+	//! @param visitor : Callable that receives the bucket index and a LocalIterator to the first node of its chain.
+	//! It must not modify this container.
+	template<class Visitor>
+	void forEachBucket(Visitor visitor) const;
+
+	//! @short Calls a visitor for every value in ascending order of the values.
+	//! The nodes are read sequentially and unused nodes are skipped 64 at a time using a bitmap of used values.
+	//! @param visitor : Callable that receives a value and its internal hash. It must not modify this container.
+	template<class Visitor>
+	void forEachValue(Visitor visitor) const;
+
+	//! @short Calls a visitor once for every group of values that share their bucket and internal hash.
+	//! Nodes with equal internal hashes are kept adjacent on insert, so the groups are found in a single pass over the chains.
+	//! @param visitor : Callable that receives the bucket index, the internal hash, a pointer to the values of the group
+	//! and their number. The pointer is only valid during the call. The visitor must not modify this container.
+	template<class Visitor>
+	void forEachGroup(Visitor visitor) const;
+
+	//! @short Splits the buckets into consecutive ranges that hold about the same number of entries.
+	//! The number of entries is counted per block of buckets, so only the chains of the blocks that contain a boundary are walked.
+	//! @param count : Number of ranges to return. Some ranges might be empty.
+	//! @return Vector of count ranges that cover all buckets in order.
+	std::vector<BucketRange> partitions(size_t count) const;
+
+	//! @short Calls a visitor for every value inside a range of buckets in the same order as an Iterator would.
+	//! @param range : The buckets to visit, for example one of the ranges returned by partitions.
+	//! @param visitor : Callable that receives a value. It must not modify this container.
+	template<class Visitor>
+	void forEach(const BucketRange &range, Visitor visitor) const;
+
+	//! @short Calls a visitor for every value using several threads. The order of the calls is unspecified.
+	//! @param threads : Number of partitions to visit in parallel. 0 uses one partition per hardware thread.
+	//! @param visitor : Callable that receives a value. It is shared by all threads and must not modify this container.
+	template<class Visitor>
+	void parallelForEach(size_t threads, Visitor visitor) const;
+
+	//! @short Calls a visitor for every value using a custom executor. The order of the calls is unspecified.
+	//! @param threads : Number of partitions to visit in parallel. 0 uses one partition per hardware thread.
+	//! @param visitor : Callable that receives a value. It is shared by all tasks and must not modify this container.
+	//! @param executor : Callable that receives a vector of tasks and returns after all of them were run.
+	template<class Visitor, class Executor>
+	void parallelForEach(size_t threads, Visitor visitor, Executor executor) const;
+
 	//! @short Constructs a node with the given parameter but does not insert it into the bucket structure.
 	//! @remark This function is intended to be used with insertEmplaced and findEmplaced but does not interact with find.
 	//! @param hash The hash to emplace.
@@ -203,23 +557,206 @@ public:
 	//! @short Returns the number of buckets of this instance.
 	sizeType buckets() const;
 
+	//! @short Returns the number of candidate buckets of every hash.
+	BucketChoice bucketChoice() const;
+
 	//! @short Returns the internal hash of an entry.
 	hashType hash(sizeType index);
 
+	//! @short Exports all entries sorted by their bucket. Entries of the same bucket are sorted by their internal hash and then by value.
+	//! This is the order of the chains, so only chains of the self organizing mode are sorted.
+	//! @return Vector of entries that can be processed sequentially.
+	std::vector<Entry> exportSorted() const;
+
+	//! @short Exports all values grouped by their bucket.
+	//! @return BucketTable with buckets() + 1 offsets.
+	BucketTable exportBuckets() const;
+
+	//! @short Writes a snapshot of this container to a stream.
+	//! The snapshot consists of a SnapshotHeader followed by the raw bucket and node arrays.
+	//! @param stream : The binary stream to write to.
+	void save(std::ostream &stream) const;
+
+	//! @short Constructs a container from a snapshot written by save.
+	//! @param stream : The binary stream to read from.
+	//! @throw std::runtime_error when the snapshot is truncated or was written by an incompatible container.
+	static GenericHashContainer load(std::istream &stream);
+
+	//! @short Writes a compressed snapshot of this container to a stream.
+	//! Runs of empty buckets are run-length encoded and all indices are stored as
+	//! zigzag varint deltas, which shrinks sparse or bucket-sorted containers considerably.
+	//! @param stream : The binary stream to write to.
+	void saveCompressed(std::ostream &stream) const;
+
+	//! @short Constructs a container from a snapshot written by saveCompressed.
+	//! @param stream : The binary stream to read from.
+	//! @throw std::runtime_error when the snapshot is truncated, corrupt or was written by an incompatible container.
+	static GenericHashContainer loadCompressed(std::istream &stream);
+
 protected:
 
 	//! @short Internal find used by public find functions.
 	SearchIterator find(hashType hash, sizeType pos) const;
 
-	//! @short Internal find used by Iterator.
-	sizeType findNext(sizeType current) const;
+	//! @short Takes a value from the free list or a value that was never used.
+	//! @return __sizeLimits::max()__ when every value is in use.
+	sizeType allocate() const;
+
+	//! @short The LinkPosition describes where a search that found no matching Node links a new Node of the searched hash.
+	struct LinkPosition
+	{
+		//! @short The Bucket the new Node is linked into.
+		sizeType bucket;
+
+		//! @short The Node the new Node is linked behind, or sizeLimits::max() to link it first.
+		sizeType previous;
+
+		//! @short The Node the search stopped at, or sizeLimits::max() when it reached the end of the chain.
+		sizeType next;
+
+		//! @short Number of Nodes the search passed in the chain of bucket.
+		//! Once the position is chosen, this is the length of the chain, counted up to overflowThreshold + 1 Nodes like chainLength.
+		sizeType length;
+
+		//! @short Whether the chain of bucket holds the hash already.
+		bool hashFound;
+	};
+
+	//! @short Internal find used by findIf and findOrInsert. Returns the matching value or sizeLimits::max().
+	//! @param previous : Position of the Node linking to current. Receives the position of the Node linking to the returned Node.
+	//! @param position : Receives where a new Node of hash is linked into the chain when no value matches.
+	template<class Predicate>
+	sizeType findInChain(hashType hash, sizeType current, Predicate &pred, sizeType &previous, LinkPosition &position) const;
+
+	//! @short Returns where a new Node of hash is linked. Both candidate Buckets are searched once.
+	LinkPosition linkPosition(sizeType bucket, hashType hash) const;
+
+	//! @short Returns where a new Node of hash is linked into the chain of a bucket.
+	//! Indexed chains are not walked, since link finds the position in their overflow entries.
+	LinkPosition chainPosition(sizeType bucket, hashType hash) const;
+
+	//! @short Counts the remaining Nodes of the chain behind the Node a search stopped at. See LinkPosition::length.
+	void completeLength(LinkPosition &position) const;
+
+	//! @short Chooses the position of a new Node among the positions in both candidate Buckets.
+	//! The Bucket that holds the hash already is preferred, otherwise the one with the shorter chain,
+	//! which keeps the longest chain at O(log log n) entries. Both lengths have to be complete.
+	static const LinkPosition &choosePosition(const LinkPosition &first, const LinkPosition &second);
+
+	//! @short Links a node whose hash is already set at a position found by a search and marks it as used.
+	//! A chain is indexed by overflow entries once it grows beyond overflowThreshold nodes or an unlink passed that many of its nodes.
+	//! @return __Position of the Node linking to value__, or sizeLimits::max() when value is the first Node of its chain.
+	sizeType link(sizeType value, const LinkPosition &position) const;
+
+	//! @short Returns the node a search for a hash starts at and sets previous to the node linking to it.
+	//! Long chains are indexed by their overflow entries, so all nodes with a smaller hash are skipped.
+	sizeType chainStart(sizeType bucket, hashType hash, sizeType &previous) const;
+
+	//! @short Returns the length of a chain, but stops counting after overflowThreshold + 1 nodes.
+	sizeType chainLength(sizeType bucket) const;
+
+	//! @short Returns the overflow entries of a bucket or nullptr when its chain is not indexed.
+	std::set<Entry> *overflowEntries(sizeType bucket) const;
+
+	//! @short Removes an overflow entry and drops the index of the bucket when its chain became short.
+	void eraseOverflowEntry(sizeType bucket, std::set<Entry> &entries, typename std::set<Entry>::iterator entry) const;
+
+	//! @short Rebuilds the overflow entries of a bucket from its chain.
+	//! @param create : __True__ to index the chain even if it is not indexed yet.
+	void refreshOverflowEntries(sizeType bucket, bool create) const;
+
+	//! @short Rebuilds the overflow entries of all buckets whose chains are longer than overflowThreshold.
+	void rebuildOverflowList() const;
+
+	//! @short Internal find used by findIf and findOrInsert that searches both candidate Buckets.
+	//! When no value matches, the new Node is linked into the Bucket that holds the hash already,
+	//! or else into the one whose search passed fewer nodes, since later searches for the hash pass them as well.
+	//! @param bucket : Any candidate Bucket of hash. Receives the Bucket of the returned Node.
+	//! @param previous : Receives the position of the Node linking to the returned Node.
+	//! @param position : Receives where a new Node of hash is linked when no value matches and linking is set.
+	//! When a value matches, it receives the Node in front of the run of hash in the chain of the returned Node.
+	//! @param linking : __True__ to choose the position of a new Node on a miss, which counts the rest of the searched chains.
+	template<class Predicate>
+	sizeType searchIf(hashType hash, sizeType &bucket, Predicate &pred, sizeType &previous, LinkPosition &position, bool linking) const;
+
+	//! @short Unlinks a node from the chain of a bucket.
+	//! @return __True__ when the node was part of the chain.
+	bool unlink(sizeType bucket, sizeType value) const;
+
+	//! @short Moves the run of nodes with the hash of a found node to the front of its chain in self organizing mode.
+	//! The whole run is moved, so its nodes stay adjacent.
+	//! @param previous : Position of the Node in front of the run, or sizeLimits::max() when the run is at the front already.
+	//! @return __True__ when the nodes were moved.
+	bool promote(sizeType bucket, sizeType found, sizeType previous) const;
+
+	//! @short Marks a value that was unlinked from the chain of a bucket as unused.
+	void release(sizeType bucket, sizeType value) const;
+
+	//! @short Moves every node to a new position and rewrites all links accordingly.
+	//! @param mapping : The new position of every node that is part of a chain.
+	//! @param count : Number of nodes that are part of a chain.
+	void renumber(const std::vector<sizeType> &mapping, sizeType count) const;
+
+	//! @short Internal find used by SearchIterator.
+	//! @param bucket : The Bucket of current. Receives the Bucket of the returned Node.
+	//! @param previous : Receives the position of the Node linking to the returned Node.
+	sizeType nextMatch(sizeType current, sizeType &bucket, sizeType &previous) const;
+
+	//! @short Internal find that continues with the second candidate Bucket when the chain of the first one ends.
+	//! @param bucket : The Bucket of current. Receives the Bucket of the returned Node.
+	//! @param previous : The position of the Node linking to current. Receives the position of the Node linking to the returned Node.
+	sizeType searchNext(hashType hash, sizeType current, sizeType &bucket, sizeType &previous) const;
+
+	//! @short Returns the other candidate Bucket of a hash, or bucket itself with SingleChoice.
+	sizeType alternateBucket(sizeType bucket, hashType hash) const;
+
+	//! @short Returns the candidate Bucket that is searched first.
+	sizeType firstBucket(sizeType bucket, hashType hash) const;
 
 	//! @short Internal find to retrieve the next hash.
-	sizeType findNext(hashType hash, sizeType current) const;
+	//! @param previous : The position of the Node linking to current. Receives the position of the Node linking to the returned Node.
+	sizeType findNext(hashType hash, sizeType current, sizeType &previous) const;
 
 	//! @short Internal function to access the next Element.
 	sizeType nextElement(sizeType current, sizeType &bucket) const;
 
+	//! @short Prefetches the successor of a node in its chain. Used by PrefetchingSearchIterator.
+	//! @return __Position of the successor__, or sizeLimits::max() when the chain or the run of hash ends.
+	sizeType prefetchNext(sizeType current, hashType hash) const;
+
+	//! @short Prefetches the first nodes of the buckets after prefetched up to limit. Used by PrefetchingIterator.
+	//! @param prefetched : The last bucket that was prefetched. Receives the new last bucket.
+	void prefetchBuckets(sizeType &prefetched, size_t limit) const;
+
+	//! @short Issues a non-blocking prefetch of address into the cache.
+	static void prefetchAddress(const void *address);
+
+	//! @short Returns the position of the lowest set bit of a word that is not 0.
+	static unsigned countTrailingZeros(uint64_t word);
+
+	//! @short Marks a value as part of a chain or as unused in the bitmap of used values.
+	void setUsed(sizeType value, bool used) const;
+
+	//! @short Recomputes the bitmap of used values by walking every chain.
+	//! @throw std::runtime_error when a chain links to an invalid node or contains a cycle.
+	void rebuildUsedList() const;
+
+	//! @short Checks the free list used by insert(hash) after loading a snapshot. Requires the bitmap of used values.
+	//! @throw std::runtime_error when the free list links to a used or never chosen value or contains a cycle.
+	void checkFreeList() const;
+
+	//! @short Sorts every chain by hash and value. This is required for snapshots that were written without sorted chains.
+	void sortChains() const;
+
+	//! @short Returns whether the Node left comes before the Node right in a sorted chain.
+	bool precedes(sizeType left, sizeType right) const;
+
+	//! @short Returns the number of words of the bitmap of used values.
+	size_t usedWords() const;
+
+	//! @short Returns the number of blocks of buckets whose entries are counted for partitions.
+	size_t occupancyBlocks() const;
+
 	//! @short Returns the highest part of hash that fits into hashType.
 	static hashType high(size_t hash);
 
@@ -228,6 +765,45 @@ protected:
 
 	static sizeType computeBucketCount(size_t entries);
 
+	//! @short Checks the sizes of a container with a custom number of buckets.
+	//! @return __buckets__ as sizeType.
+	//! @throw std::runtime_error when a size does not fit into sizeType or there are entries but no buckets.
+	static sizeType checkBucketCount(size_t entries, size_t buckets);
+
+	//! @short Returns a SnapshotHeader describing this container.
+	//! @param magic : Identifies the encoding of the data following the header.
+	SnapshotHeader snapshotHeader(uint32_t magic) const;
+
+	//! @short Validates a snapshot header and constructs an empty container that matches it.
+	static GenericHashContainer fromSnapshotHeader(const SnapshotHeader &header, uint32_t magic);
+
+	//! @short Appends an unsigned integer as LEB128 varint.
+	static void writeVarint(std::vector<uint8_t> &buffer, uint64_t value);
+
+	//! @short Reads a LEB128 varint and advances position.
+	//! @throw std::runtime_error when the varint exceeds the buffer or 64 bits.
+	static uint64_t readVarint(const uint8_t *&position, const uint8_t *end);
+
+	//! @short Maps a signed difference onto an unsigned integer so small differences of either sign stay small.
+	static uint64_t zigzag(uint64_t difference);
+
+	//! @short Inverse of zigzag.
+	static uint64_t unzigzag(uint64_t value);
+
+	static const uint32_t snapshotMagic = 0x48434e54;
+	static const uint32_t compressedSnapshotMagic = 0x48434e43;
+	static const uint32_t snapshotVersion = 3;
+	static const uint32_t twoChoicesFlag = 1;
+
+	//! @short Number of buckets whose chains are prefetched ahead of a sweep over all buckets.
+	static const sizeType bucketPrefetchDistance = 8;
+
+	//! @short Number of nodes a PrefetchingSearchIterator prefetches ahead by default.
+	static const sizeType chainPrefetchDistance = 2;
+
+	//! @short Chains with more nodes are indexed by overflow entries. The index is dropped at half of this length.
+	static const sizeType overflowThreshold = 32;
+
 	template<class T>
 	std::unique_ptr<T[]> copyArray(const std::unique_ptr<T[]> &reference, sizeType size);
 
@@ -237,6 +813,39 @@ protected:
 	std::unique_ptr<Bucket[]> m_bucketList;
 	std::unique_ptr<Node[]> m_nodeList;
 
+	//! @short Bitmap with one bit per node that is set while the node is part of a chain.
+	std::unique_ptr<uint64_t[]> m_usedList;
+
+	//! @short Number of entries in every block of occupancyBlockSize buckets, so partitions does not need to walk every chain.
+	std::unique_ptr<sizeType[]> m_occupancyList;
+
+	//! @short First unused node of the free list used by insert(hash). Unused nodes are linked by their next member.
+	mutable sizeType m_freeHead;
+
+	//! @short Nodes below this position were chosen by insert(hash) before. Nodes above were never used.
+	mutable sizeType m_allocatedCount;
+
+	//! @short Found entries are moved to the front of their chain while this is set. Chains are only sorted while it is not set.
+	mutable bool m_selfOrganizing;
+
+	//! @short Number of searches that need to find an entry behind the front of its chain until it is moved.
+	mutable uint32_t m_promoteInterval;
+
+	//! @short Searches that found an entry behind the front of its chain since the last move.
+	mutable uint32_t m_hitCount;
+
+	//! @short Copies of the (hash, value) pairs of long chains in chain order, so their nodes are found, linked and unlinked in logarithmic time.
+	//! The chains stay the primary structure. Overflow entries are only kept while chains are sorted.
+	mutable std::unordered_map<sizeType, std::set<Entry>> m_overflowList;
+
+	BucketChoice m_bucketChoice;
+
+	template<typename container_t>
+	friend class HashContainerLoader;
+
+	template<typename pagedSizeType_t, typename pagedHashType_t>
+	friend class GenericPagedHashContainer;
+
 	static_assert(sizeof(size_t) == 8, "Hash data type must be 64 bit.");
 	static_assert(sizeof(sizeType) <= sizeof(size_t), "sizeType must not be larger than size_t.");
 	static_assert(sizeof(hashType) < sizeof(size_t), "hashType must not be larger than size_t.");
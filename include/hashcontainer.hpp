@@ -1,10 +1,25 @@
 
 template <typename sizeType, typename hashType>
-GenericHashContainer<sizeType, hashType>::GenericHashContainer(size_t entries)
-	: m_bucketCount(computeBucketCount(entries))
+GenericHashContainer<sizeType, hashType>::GenericHashContainer(size_t entries, BucketChoice choice)
+	: GenericHashContainer(entries, computeBucketCount(entries), choice)
+{
+}
+
+template<typename sizeType, typename hashType>
+GenericHashContainer<sizeType, hashType>::GenericHashContainer(size_t entries, size_t buckets, BucketChoice choice)
+	: m_bucketCount(checkBucketCount(entries, buckets))
 	, m_nodeCount(static_cast<sizeType>(entries))
 	, m_bucketList(std::make_unique<Bucket[]>(m_bucketCount))
 	, m_nodeList(std::make_unique<Node[]>(m_nodeCount))
+	, m_usedList(std::make_unique<uint64_t[]>(usedWords()))
+	, m_occupancyList(std::make_unique<sizeType[]>(occupancyBlocks()))
+	, m_freeHead(sizeLimits::max())
+	, m_allocatedCount(0)
+	, m_selfOrganizing(false)
+	, m_promoteInterval(1)
+	, m_hitCount(0)
+	, m_overflowList()
+	, m_bucketChoice(choice)
 {
 	clear();
 }
@@ -15,6 +30,15 @@ GenericHashContainer<sizeType, hashType>::GenericHashContainer(const GenericHash
 	, m_nodeCount(other.m_nodeCount)
 	, m_bucketList(copyArray(other.m_bucketList, m_bucketCount))
 	, m_nodeList(copyArray(other.m_nodeList, m_nodeCount))
+	, m_usedList(copyArray(other.m_usedList, static_cast<sizeType>(other.usedWords())))
+	, m_occupancyList(copyArray(other.m_occupancyList, static_cast<sizeType>(other.occupancyBlocks())))
+	, m_freeHead(other.m_freeHead)
+	, m_allocatedCount(other.m_allocatedCount)
+	, m_selfOrganizing(other.m_selfOrganizing)
+	, m_promoteInterval(other.m_promoteInterval)
+	, m_hitCount(other.m_hitCount)
+	, m_overflowList(other.m_overflowList)
+	, m_bucketChoice(other.m_bucketChoice)
 {
 }
 
@@ -24,6 +48,15 @@ GenericHashContainer<sizeType, hashType>::GenericHashContainer(GenericHashContai
 	, m_nodeCount(other.m_nodeCount)
 	, m_bucketList(std::move(other.m_bucketList))
 	, m_nodeList(std::move(other.m_nodeList))
+	, m_usedList(std::move(other.m_usedList))
+	, m_occupancyList(std::move(other.m_occupancyList))
+	, m_freeHead(other.m_freeHead)
+	, m_allocatedCount(other.m_allocatedCount)
+	, m_selfOrganizing(other.m_selfOrganizing)
+	, m_promoteInterval(other.m_promoteInterval)
+	, m_hitCount(other.m_hitCount)
+	, m_overflowList(std::move(other.m_overflowList))
+	, m_bucketChoice(other.m_bucketChoice)
 {
 }
 
@@ -49,6 +82,17 @@ inline void GenericHashContainer<sizeType, hashType>::swap(GenericHashContainer
 
 	std::swap(m_bucketList, other.m_bucketList);
 	std::swap(m_nodeList, other.m_nodeList);
+	std::swap(m_usedList, other.m_usedList);
+	std::swap(m_occupancyList, other.m_occupancyList);
+
+	std::swap(m_freeHead, other.m_freeHead);
+	std::swap(m_allocatedCount, other.m_allocatedCount);
+
+	std::swap(m_selfOrganizing, other.m_selfOrganizing);
+	std::swap(m_promoteInterval, other.m_promoteInterval);
+	std::swap(m_hitCount, other.m_hitCount);
+	std::swap(m_overflowList, other.m_overflowList);
+	std::swap(m_bucketChoice, other.m_bucketChoice);
 }
 
 template<typename sizeType, typename hashType>
@@ -59,12 +103,19 @@ inline void GenericHashContainer<sizeType, hashType>::insert(size_t hash, sizeTy
 
 	// The low part refers to the bucket and the high part
 	// is used to distinct different entries in a single bucket.
-	auto bucket = &m_bucketList[low(hash) % m_bucketCount];
-
-	// Let the bucket point to the new inserted element.
-	m_nodeList[value].next = bucket->first;
 	m_nodeList[value].hash = high(hash);
-	bucket->first = value;
+	link(value, linkPosition(low(hash) % m_bucketCount, high(hash)));
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::insert(size_t hash) const
+{
+	const sizeType value = allocate();
+	if (value != sizeLimits::max())
+	{
+		insert(hash, value);
+	}
+	return value;
 }
 
 template<typename sizeType, typename hashType>
@@ -76,40 +127,204 @@ inline void GenericHashContainer<sizeType, hashType>::remove(size_t hash, sizeTy
 		return;
 	}
 
-	// Just remove the entry when it is the first entry.
-	sizeType current = m_bucketList[low(hash) % m_bucketCount].first;
-	if (current == value)
+	// With two choices the node is linked into one of both buckets.
+	const sizeType bucket = low(hash) % m_bucketCount;
+	const sizeType alternate = alternateBucket(bucket, high(hash));
+	if (unlink(bucket, value))
+	{
+		release(bucket, value);
+	}
+	else if (alternate != bucket && unlink(alternate, value))
 	{
-		m_bucketList[low(hash) % m_bucketCount].first = m_nodeList[value].next;
+		release(alternate, value);
+	}
+}
 
-#ifndef NDEBUG
-		// It is necessary to overwrite the memory in debug mode with an
-		// invalid value to get the assertion detect invalid operations.
-		m_nodeList[value].next = sizeLimits::max();
-		m_nodeList[value].hash = hashLimits::max();
-#endif
+template<typename sizeType, typename hashType>
+inline bool GenericHashContainer<sizeType, hashType>::unlink(sizeType bucket, sizeType value) const
+{
+	// The overflow entries of long chains contain the previous node, so there is no need to walk the chain.
+	std::set<Entry> *entries = overflowEntries(bucket);
+	if (entries != nullptr)
+	{
+		const auto entry = entries->find({ m_nodeList[value].hash, value });
+		if (entry == entries->end())
+		{
+			return false;
+		}
 
-		return;
+		sizeType *link = entry == entries->begin() ? &m_bucketList[bucket].first : &m_nodeList[std::prev(entry)->value].next;
+		*link = m_nodeList[value].next;
+		eraseOverflowEntry(bucket, *entries, entry);
+		return true;
+	}
+
+	// Just remove the entry when it is the first entry.
+	sizeType current = m_bucketList[bucket].first;
+	if (current == value)
+	{
+		m_bucketList[bucket].first = m_nodeList[value].next;
+		return true;
 	}
 
 	// When it is not the first entry we need to find the element
 	// that points to the removed element to adjust its next pointer.
-	while (current != sizeLimits::max())
+	// A sorted chain allows to end the search at the first node with a larger hash.
+	sizeType length = 0;
+	while (current != sizeLimits::max() && m_nodeList[current].next != value)
+	{
+		current = m_selfOrganizing || m_nodeList[current].hash <= m_nodeList[value].hash ? m_nodeList[current].next : sizeLimits::max();
+		++length;
+	}
+
+	if (current == sizeLimits::max())
+	{
+		return false;
+	}
+
+	m_nodeList[current].next = m_nodeList[value].next;
+
+	// Like link, index the chain once a walk passed too many of its nodes.
+	if (!m_selfOrganizing && length >= overflowThreshold)
+	{
+		refreshOverflowEntries(bucket, true);
+	}
+	return true;
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::SearchIterator GenericHashContainer<sizeType, hashType>::erase(SearchIterator it) const
+{
+	assert(it);
+	assert(it.m_container == this);
+
+	// The iterator knows which link points to the node, so there is no need to walk the chain.
+	const sizeType value = *it;
+	const sizeType next = m_nodeList[value].next;
+	const hashType hash = m_nodeList[value].hash;
+	if (it.m_previous == sizeLimits::max())
 	{
-		if (m_nodeList[current].next == value)
+		m_bucketList[it.m_bucket].first = next;
+	}
+	else
+	{
+		m_nodeList[it.m_previous].next = next;
+	}
+
+	std::set<Entry> *entries = overflowEntries(it.m_bucket);
+	if (entries != nullptr)
+	{
+		eraseOverflowEntry(it.m_bucket, *entries, entries->find({ hash, value }));
+	}
+	release(it.m_bucket, value);
+
+	sizeType bucket = it.m_bucket;
+	sizeType previous = it.m_previous;
+	const sizeType found = searchNext(hash, next, bucket, previous);
+	return SearchIterator(*this, found, bucket, previous);
+}
+
+template<typename sizeType, typename hashType>
+template<class Predicate>
+inline size_t GenericHashContainer<sizeType, hashType>::removeIf(Predicate pred) const
+{
+	size_t removed = 0;
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		// Relink the chain in place by keeping track of the link that points to the current node.
+		sizeType *link = &m_bucketList[bucket].first;
+		while (*link != sizeLimits::max())
 		{
-			m_nodeList[current].next = m_nodeList[value].next;
+			const sizeType current = *link;
+			if (pred(current))
+			{
+				*link = m_nodeList[current].next;
+				release(bucket, current);
+				++removed;
+			}
+			else
+			{
+				link = &m_nodeList[current].next;
+			}
 		}
+		refreshOverflowEntries(bucket, false);
+	}
 
-		current = m_nodeList[current].next;
+	return removed;
+}
+
+template<typename sizeType, typename hashType>
+template<class Predicate>
+inline size_t GenericHashContainer<sizeType, hashType>::retainIf(Predicate pred) const
+{
+	return removeIf([&pred](sizeType value) { return !pred(value); });
+}
+
+template<typename sizeType, typename hashType>
+template<class InputIt>
+inline size_t GenericHashContainer<sizeType, hashType>::removeBatch(InputIt first, InputIt last) const
+{
+	struct Request
+	{
+		sizeType bucket;
+		sizeType value;
+		hashType hash;
+
+		bool operator<(const Request &other) const
+		{
+			return bucket != other.bucket ? bucket < other.bucket : value < other.value;
+		}
+	};
+
+	std::vector<Request> requests;
+	for (; first != last; ++first)
+	{
+		const size_t hash = first->first;
+		const sizeType bucket = low(hash) % m_bucketCount;
+		requests.push_back({ bucket, first->second, high(hash) });
+
+		// With two choices the node might be linked into the other bucket. It is only found in one of both.
+		const sizeType alternate = alternateBucket(bucket, high(hash));
+		if (alternate != bucket)
+		{
+			requests.push_back({ alternate, first->second, high(hash) });
+		}
 	}
+	std::sort(requests.begin(), requests.end());
 
-#ifndef NDEBUG
-	// It is necessary to overwrite the memory in debug mode with an
-	// invalid value to get the assertion detect invalid operations.
-	m_nodeList[value].next = sizeLimits::max();
-	m_nodeList[value].hash = hashLimits::max();
-#endif
+	size_t removed = 0;
+	for (auto begin = requests.begin(); begin != requests.end();)
+	{
+		auto end = begin;
+		while (end != requests.end() && end->bucket == begin->bucket)
+		{
+			++end;
+		}
+
+		// Walk the chain once and look up every node in the requests for its bucket, which are sorted by value.
+		sizeType *link = &m_bucketList[begin->bucket].first;
+		while (*link != sizeLimits::max())
+		{
+			const sizeType current = *link;
+			const Request key = { begin->bucket, current, 0 };
+			auto request = std::lower_bound(begin, end, key);
+			if (request != end && request->value == current && request->hash == m_nodeList[current].hash)
+			{
+				*link = m_nodeList[current].next;
+				release(begin->bucket, current);
+				++removed;
+			}
+			else
+			{
+				link = &m_nodeList[current].next;
+			}
+		}
+		refreshOverflowEntries(begin->bucket, false);
+
+		begin = end;
+	}
+
+	return removed;
 }
 
 template<typename sizeType, typename hashType>
@@ -121,158 +336,1487 @@ inline void GenericHashContainer<sizeType, hashType>::clear() const
 	std::memset(m_nodeList.get(), std::numeric_limits<unsigned char>::max(), sizeof(Node) * m_nodeCount);
 #endif
 	std::memset(m_bucketList.get(), std::numeric_limits<unsigned char>::max(), sizeof(Bucket) * m_bucketCount);
-}
+	std::memset(m_usedList.get(), 0, sizeof(uint64_t) * usedWords());
+	std::memset(m_occupancyList.get(), 0, sizeof(sizeType) * occupancyBlocks());
 
-template<typename sizeType, typename hashType>
-inline typename GenericHashContainer<sizeType, hashType>::SearchIterator GenericHashContainer<sizeType, hashType>::find(size_t hash) const
-{
-	return find(high(hash), low(hash) % m_bucketCount);
+	m_overflowList.clear();
+
+	m_freeHead = sizeLimits::max();
+	m_allocatedCount = 0;
 }
 
 template<typename sizeType, typename hashType>
-inline typename GenericHashContainer<sizeType, hashType>::SearchIterator GenericHashContainer<sizeType, hashType>::find(hashType hash, sizeType pos) const
+inline std::vector<sizeType> GenericHashContainer<sizeType, hashType>::compact() const
 {
-	return SearchIterator(*this, findNext(hash, m_bucketList[pos].first));
+	// Mark every node that is part of a chain first and number them in the order of their values afterwards.
+	std::vector<sizeType> mapping(m_nodeCount, sizeLimits::max());
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		for (sizeType current = m_bucketList[bucket].first; current != sizeLimits::max(); current = m_nodeList[current].next)
+		{
+			mapping[current] = 0;
+		}
+	}
+
+	sizeType count = 0;
+	for (sizeType &position : mapping)
+	{
+		if (position != sizeLimits::max())
+		{
+			position = count++;
+		}
+	}
+
+	renumber(mapping, count);
+	return mapping;
 }
 
 template<typename sizeType, typename hashType>
-inline void GenericHashContainer<sizeType, hashType>::emplace(size_t hash, sizeType value) const
+inline std::vector<sizeType> GenericHashContainer<sizeType, hashType>::reorderForLocality() const
 {
-	assert(value != sizeLimits::max());
-	assert(m_nodeList[value].next == sizeLimits::max());
+	// Number the nodes in the order the chains are walked.
+	std::vector<sizeType> mapping(m_nodeCount, sizeLimits::max());
+	sizeType count = 0;
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		for (sizeType current = m_bucketList[bucket].first; current != sizeLimits::max(); current = m_nodeList[current].next)
+		{
+			mapping[current] = count++;
+		}
+	}
 
-	// Construct a new node but do not insert it into the bucket structure.
-	m_nodeList[value].next = low(hash) % m_bucketCount;
-	m_nodeList[value].hash = high(hash);
+	renumber(mapping, count);
+	return mapping;
 }
 
 template<typename sizeType, typename hashType>
-inline void GenericHashContainer<sizeType, hashType>::insertEmplaced(sizeType value) const
+inline void GenericHashContainer<sizeType, hashType>::setSelfOrganizing(bool enabled, uint32_t interval) const
 {
-	assert(value != sizeLimits::max());
-	assert(m_nodeList[value].next != sizeLimits::max());
-
-	// When the element is already emplaced we only need to update the bucket structure.
-	auto bucket = &m_bucketList[m_nodeList[value].next];
+	m_promoteInterval = std::max<uint32_t>(interval, 1);
+	m_hitCount = 0;
+	if (m_selfOrganizing == enabled)
+	{
+		return;
+	}
 
-	m_nodeList[value].next = bucket->first;
-	bucket->first = value;
+	// Searches rely on sorted chains again, so the chains that were reordered need to be sorted.
+	// Overflow entries mirror sorted chains, so they are only used while the mode is disabled.
+	m_selfOrganizing = enabled;
+	if (!enabled)
+	{
+		sortChains();
+	}
+	else
+	{
+		m_overflowList.clear();
+	}
 }
 
 template<typename sizeType, typename hashType>
-inline typename GenericHashContainer<sizeType, hashType>::SearchIterator GenericHashContainer<sizeType, hashType>::findEmplaced(sizeType pos) const
+inline bool GenericHashContainer<sizeType, hashType>::selfOrganizing() const
 {
-	assert(pos != sizeLimits::max());
-	assert(m_nodeList[pos].next != sizeLimits::max());
-
-	return find(m_nodeList[pos].hash, m_nodeList[pos].next);
+	return m_selfOrganizing;
 }
 
 template<typename sizeType, typename hashType>
-inline typename GenericHashContainer<sizeType, hashType>::Iterator GenericHashContainer<sizeType, hashType>::begin() const
+inline void GenericHashContainer<sizeType, hashType>::renumber(const std::vector<sizeType> &mapping, sizeType count) const
 {
-	// Find the first bucket that has a valid first pointer.
-	sizeType bucket = 0;
-	while (m_bucketList[bucket].first == sizeLimits::max())
+	// Unused nodes of the new list are invalid just like after clear in debug mode.
+	std::unique_ptr<Node[]> nodeList = std::make_unique<Node[]>(m_nodeCount);
+	std::memset(nodeList.get(), std::numeric_limits<unsigned char>::max(), sizeof(Node) * m_nodeCount);
+
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
 	{
-		++bucket;
-		if (bucket == m_bucketCount)
+		sizeType current = m_bucketList[bucket].first;
+		if (current == sizeLimits::max())
 		{
-			return end();
+			continue;
+		}
+
+		m_bucketList[bucket].first = mapping[current];
+		while (current != sizeLimits::max())
+		{
+			const sizeType next = m_nodeList[current].next;
+			nodeList[mapping[current]].hash = m_nodeList[current].hash;
+			nodeList[mapping[current]].next = next != sizeLimits::max() ? mapping[next] : sizeLimits::max();
+			current = next;
 		}
 	}
 
-	return Iterator(*this, m_bucketList[bucket].first, bucket);
+	std::memcpy(m_nodeList.get(), nodeList.get(), sizeof(Node) * m_nodeCount);
+	rebuildUsedList();
+
+	// Nodes of the same hash are sorted by value, which the mapping might not keep.
+	if (m_selfOrganizing)
+	{
+		m_overflowList.clear();
+	}
+	else
+	{
+		sortChains();
+	}
+
+	// All used values are dense now, so the free list is empty.
+	m_freeHead = sizeLimits::max();
+	if (m_allocatedCount != 0)
+	{
+		m_allocatedCount = count;
+	}
 }
 
 template<typename sizeType, typename hashType>
-inline typename GenericHashContainer<sizeType, hashType>::Iterator GenericHashContainer<sizeType, hashType>::end() const
+inline void GenericHashContainer<sizeType, hashType>::prefetch(size_t hash) const
 {
-	return Iterator(*this, sizeLimits::max(), 0);
+	const sizeType bucket = low(hash) % m_bucketCount;
+	const sizeType alternate = alternateBucket(bucket, high(hash));
+	prefetchAddress(&m_bucketList[bucket]);
+	if (alternate != bucket)
+	{
+		prefetchAddress(&m_bucketList[alternate]);
+	}
+
+	// The node prefetches depend on loading the buckets, but an out-of-order core continues with independent work meanwhile.
+	const sizeType first = m_bucketList[bucket].first;
+	if (first != sizeLimits::max())
+	{
+		prefetchAddress(&m_nodeList[first]);
+	}
+	if (alternate != bucket && m_bucketList[alternate].first != sizeLimits::max())
+	{
+		prefetchAddress(&m_nodeList[m_bucketList[alternate].first]);
+	}
 }
 
 template<typename sizeType, typename hashType>
-inline typename GenericHashContainer<sizeType, hashType>::LocalIterator GenericHashContainer<sizeType, hashType>::localBegin(sizeType index) const
+inline void GenericHashContainer<sizeType, hashType>::prefetchNode(sizeType value) const
 {
-	return LocalIterator(*this, m_bucketList[index].first, index);
+	assert(value < m_nodeCount);
+	prefetchAddress(&m_nodeList[value]);
 }
 
 template<typename sizeType, typename hashType>
-inline typename GenericHashContainer<sizeType, hashType>::LocalIterator GenericHashContainer<sizeType, hashType>::localEnd() const
+inline typename GenericHashContainer<sizeType, hashType>::SearchIterator GenericHashContainer<sizeType, hashType>::find(size_t hash) const
 {
-	return LocalIterator(*this, sizeLimits::max(), 0);
+	SearchIterator it = find(high(hash), low(hash) % m_bucketCount);
+	if (promote(it.m_bucket, *it, it.m_previous))
+	{
+		it.m_previous = sizeLimits::max();
+	}
+	return it;
 }
 
-template<class sizeType, class hashType>
-inline sizeType GenericHashContainer<sizeType, hashType>::findNext(sizeType current) const
+template<typename sizeType, typename hashType>
+template<class Predicate>
+inline typename GenericHashContainer<sizeType, hashType>::SearchIterator GenericHashContainer<sizeType, hashType>::findIf(size_t hash, Predicate pred) const
 {
-	return findNext(m_nodeList[current].hash, m_nodeList[current].next);
+	sizeType bucket = low(hash) % m_bucketCount;
+	sizeType previous;
+	LinkPosition position;
+	const sizeType found = searchIf(high(hash), bucket, pred, previous, position, false);
+
+	// The search passed the node in front of the run of the hash, so the run is moved as a whole.
+	// Only a node at the front of its run is linked by the bucket afterwards.
+	if (promote(bucket, found, position.previous) && previous == position.previous)
+	{
+		previous = sizeLimits::max();
+	}
+	return SearchIterator(*this, found, bucket, previous);
 }
 
 template<typename sizeType, typename hashType>
-inline sizeType GenericHashContainer<sizeType, hashType>::nodes() const
+template<class Predicate>
+inline std::pair<typename GenericHashContainer<sizeType, hashType>::SearchIterator, bool> GenericHashContainer<sizeType, hashType>::findOrInsert(size_t hash, sizeType value, Predicate pred) const
 {
-	return m_nodeCount;
+	assert(m_nodeList[value].next == sizeLimits::max());
+	assert(m_nodeList[value].hash == hashLimits::max());
+
+	sizeType index = low(hash) % m_bucketCount;
+	sizeType previous;
+	LinkPosition position;
+	const sizeType found = searchIf(high(hash), index, pred, previous, position, true);
+	if (found != sizeLimits::max())
+	{
+		return std::make_pair(SearchIterator(*this, found, index, previous), false);
+	}
+
+	// The search already passed the position of the new node, so the chain is not walked again.
+	m_nodeList[value].hash = high(hash);
+	previous = link(value, position);
+	return std::make_pair(SearchIterator(*this, value, position.bucket, previous), true);
 }
 
 template<typename sizeType, typename hashType>
-inline sizeType GenericHashContainer<sizeType, hashType>::buckets() const
+template<class Predicate>
+inline std::pair<typename GenericHashContainer<sizeType, hashType>::SearchIterator, bool> GenericHashContainer<sizeType, hashType>::findOrInsert(size_t hash, Predicate pred) const
 {
-	return m_bucketCount;
+	sizeType index = low(hash) % m_bucketCount;
+	sizeType previous;
+	LinkPosition position;
+	const sizeType found = searchIf(high(hash), index, pred, previous, position, true);
+	if (found != sizeLimits::max())
+	{
+		return std::make_pair(SearchIterator(*this, found, index, previous), false);
+	}
+
+	const sizeType value = allocate();
+	if (value == sizeLimits::max())
+	{
+		return std::make_pair(SearchIterator(*this, value, index, sizeLimits::max()), false);
+	}
+
+	m_nodeList[value].hash = high(hash);
+	previous = link(value, position);
+	return std::make_pair(SearchIterator(*this, value, position.bucket, previous), true);
 }
 
 template<typename sizeType, typename hashType>
-inline hashType GenericHashContainer<sizeType, hashType>::hash(sizeType index)
+inline sizeType GenericHashContainer<sizeType, hashType>::allocate() const
 {
-	return m_nodeList[index].hash;
+	// Reuse removed values first and only then take values that were never used.
+	if (m_freeHead != sizeLimits::max())
+	{
+		const sizeType value = m_freeHead;
+		m_freeHead = m_nodeList[value].next;
+		m_nodeList[value].next = sizeLimits::max();
+		return value;
+	}
+
+	if (m_allocatedCount < m_nodeCount)
+	{
+		return m_allocatedCount++;
+	}
+
+	return sizeLimits::max();
 }
 
 template<typename sizeType, typename hashType>
-inline sizeType GenericHashContainer<sizeType, hashType>::findNext(hashType hash, sizeType current) const
+template<class Predicate>
+inline sizeType GenericHashContainer<sizeType, hashType>::findInChain(hashType hash, sizeType current, Predicate &pred, sizeType &previous, LinkPosition &position) const
 {
+	position.previous = previous;
+	position.length = 0;
+	position.hashFound = false;
 	while (current != sizeLimits::max())
 	{
-		if (m_nodeList[current].hash == hash)
+		// Load the next node while the caller inspects its own data for the current one.
+		const sizeType next = m_nodeList[current].next;
+		if (next != sizeLimits::max())
+		{
+			prefetchAddress(&m_nodeList[next]);
+		}
+
+		if (m_nodeList[current].hash == hash && pred(current))
+		{
 			return current;
-		current = m_nodeList[current].next;
+		}
+
+		// A sorted chain can not contain the hash behind a larger one.
+		if (!m_selfOrganizing && m_nodeList[current].hash > hash)
+		{
+			break;
+		}
+
+		// A new node is linked into the run of nodes with an equal hash, so they stay adjacent.
+		if (m_nodeList[current].hash == hash)
+		{
+			position.hashFound = true;
+		}
+		else if (!position.hashFound)
+		{
+			position.previous = current;
+		}
+		++position.length;
+
+		previous = current;
+		current = next;
 	}
 
+	// Unsorted chains get new hashes at their front.
+	if (m_selfOrganizing && !position.hashFound)
+	{
+		position.previous = sizeLimits::max();
+	}
+	position.next = current;
 	return sizeLimits::max();
 }
 
 template<typename sizeType, typename hashType>
-inline sizeType GenericHashContainer<sizeType, hashType>::nextElement(sizeType current, sizeType &bucket) const
+template<class Predicate>
+inline sizeType GenericHashContainer<sizeType, hashType>::searchIf(hashType hash, sizeType &bucket, Predicate &pred, sizeType &previous, LinkPosition &position, bool linking) const
 {
-	// Iterate over a bucket.
-	if (m_nodeList[current].next != sizeLimits::max())
+	bucket = firstBucket(bucket, hash);
+	const sizeType second = alternateBucket(bucket, hash);
+	if (second != bucket)
 	{
-		return m_nodeList[current].next;
+		// Both buckets are probably searched, so load the second one while the first chain is walked.
+		prefetchAddress(&m_bucketList[second]);
 	}
 
-	// The end of the bucket is reached. We need to find the next bucket with a valid first pointer.
-	while (++bucket != m_bucketCount)
+	sizeType start = chainStart(bucket, hash, previous);
+	sizeType found = findInChain(hash, start, pred, previous, position);
+	position.bucket = bucket;
+	if (found == sizeLimits::max() && second != bucket)
 	{
-		if (m_bucketList[bucket].first != sizeLimits::max())
+		LinkPosition first = position;
+		bucket = second;
+		start = chainStart(bucket, hash, previous);
+		found = findInChain(hash, start, pred, previous, position);
+		position.bucket = bucket;
+
+		if (found == sizeLimits::max() && linking)
 		{
-			return m_bucketList[bucket].first;
+			completeLength(first);
+			completeLength(position);
+			position = choosePosition(first, position);
 		}
 	}
+	else if (found == sizeLimits::max() && linking)
+	{
+		completeLength(position);
+	}
+	return found;
+}
 
-	return std::numeric_limits<sizeType>::max();
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::LinkPosition GenericHashContainer<sizeType, hashType>::linkPosition(sizeType bucket, hashType hash) const
+{
+	bucket = firstBucket(bucket, hash);
+	const sizeType second = alternateBucket(bucket, hash);
+	if (second == bucket)
+	{
+		return chainPosition(bucket, hash);
+	}
+	return choosePosition(chainPosition(bucket, hash), chainPosition(second, hash));
 }
 
 template<typename sizeType, typename hashType>
-inline sizeType GenericHashContainer<sizeType, hashType>::computeBucketCount(size_t entries)
+inline typename GenericHashContainer<sizeType, hashType>::LinkPosition GenericHashContainer<sizeType, hashType>::chainPosition(sizeType bucket, hashType hash) const
 {
-	// It is possible to adjust the container performance by modifying this factor.
-	// Increasing it beyond 2 only results in minor performance gains and reducing it
-	// below 1 results in severe performance penalties.
-	const size_t bucketFactor = 2;
-	if (entries >= sizeLimits::max() / bucketFactor)
+	LinkPosition position;
+	std::set<Entry> *entries = overflowEntries(bucket);
+	if (entries != nullptr)
 	{
-		throw std::runtime_error("HashContainer: Size is too large.");
+		const auto entry = entries->lower_bound({ hash, 0 });
+		position.previous = sizeLimits::max();
+		position.next = sizeLimits::max();
+		position.length = 0;
+		position.hashFound = entry != entries->end() && entry->hash == hash;
 	}
-	return static_cast<sizeType>(bucketFactor * entries);
+	else
+	{
+		sizeType previous = sizeLimits::max();
+		auto none = [](sizeType) { return false; };
+		findInChain(hash, m_bucketList[bucket].first, none, previous, position);
+	}
+	position.bucket = bucket;
+	completeLength(position);
+	return position;
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::completeLength(LinkPosition &position) const
+{
+	// Indexed chains know their length from the overflow entries.
+	std::set<Entry> *entries = overflowEntries(position.bucket);
+	if (entries != nullptr)
+	{
+		position.length = static_cast<sizeType>(std::min<size_t>(entries->size(), overflowThreshold + 1));
+		return;
+	}
+
+	// The walk continues where the search stopped, so every node is visited once.
+	for (sizeType current = position.next; current != sizeLimits::max() && position.length <= overflowThreshold; current = m_nodeList[current].next)
+	{
+		++position.length;
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline const typename GenericHashContainer<sizeType, hashType>::LinkPosition &GenericHashContainer<sizeType, hashType>::choosePosition(const LinkPosition &first, const LinkPosition &second)
+{
+	// Nodes of the same hash stay together, otherwise the shorter chain is taken.
+	return first.hashFound || (!second.hashFound && first.length <= second.length) ? first : second;
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::SearchIterator GenericHashContainer<sizeType, hashType>::find(hashType hash, sizeType pos) const
+{
+	sizeType bucket = firstBucket(pos, hash);
+	const sizeType second = alternateBucket(bucket, hash);
+	if (second != bucket)
+	{
+		// Both buckets are probably searched, so load the second one while the first chain is walked.
+		prefetchAddress(&m_bucketList[second]);
+	}
+
+	sizeType previous;
+	const sizeType start = chainStart(bucket, hash, previous);
+	const sizeType found = searchNext(hash, start, bucket, previous);
+	return SearchIterator(*this, found, bucket, previous);
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::link(sizeType value, const LinkPosition &position) const
+{
+	// The position is in front of the run of nodes with the same hash, which is sorted by value.
+	sizeType previous = position.previous;
+	std::set<Entry> *entries = overflowEntries(position.bucket);
+	if (entries != nullptr)
+	{
+		// The overflow entries are ordered like the chain, so the entry in front of the new one is the node to link behind.
+		const auto entry = entries->insert({ m_nodeList[value].hash, value }).first;
+		previous = entry != entries->begin() ? std::prev(entry)->value : sizeLimits::max();
+	}
+	else if (!m_selfOrganizing)
+	{
+		sizeType next = previous == sizeLimits::max() ? m_bucketList[position.bucket].first : m_nodeList[previous].next;
+		while (next != sizeLimits::max() && m_nodeList[next].hash == m_nodeList[value].hash && next < value)
+		{
+			previous = next;
+			next = m_nodeList[next].next;
+		}
+	}
+
+	sizeType *link = previous == sizeLimits::max() ? &m_bucketList[position.bucket].first : &m_nodeList[previous].next;
+	m_nodeList[value].next = *link;
+	*link = value;
+	setUsed(value, true);
+	++m_occupancyList[position.bucket / occupancyBlockSize];
+
+	if (entries == nullptr && !m_selfOrganizing && position.length >= overflowThreshold)
+	{
+		refreshOverflowEntries(position.bucket, true);
+	}
+	return previous;
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::chainStart(sizeType bucket, hashType hash, sizeType &previous) const
+{
+	previous = sizeLimits::max();
+	std::set<Entry> *entries = overflowEntries(bucket);
+	if (entries == nullptr)
+	{
+		return m_bucketList[bucket].first;
+	}
+
+	// Skip every node with a smaller hash.
+	const auto entry = entries->lower_bound({ hash, 0 });
+	if (entry != entries->begin())
+	{
+		previous = std::prev(entry)->value;
+	}
+	return entry != entries->end() ? entry->value : sizeLimits::max();
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::chainLength(sizeType bucket) const
+{
+	// Only the length up to the threshold matters, so long chains are not walked completely.
+	sizeType length = 0;
+	for (sizeType current = m_bucketList[bucket].first; current != sizeLimits::max() && length <= overflowThreshold; current = m_nodeList[current].next)
+	{
+		++length;
+	}
+	return length;
+}
+
+template<typename sizeType, typename hashType>
+inline std::set<typename GenericHashContainer<sizeType, hashType>::Entry> *GenericHashContainer<sizeType, hashType>::overflowEntries(sizeType bucket) const
+{
+	// Most containers have no long chains, so avoid the lookup in that case.
+	if (m_overflowList.empty())
+	{
+		return nullptr;
+	}
+
+	const auto entries = m_overflowList.find(bucket);
+	return entries != m_overflowList.end() ? &entries->second : nullptr;
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::eraseOverflowEntry(sizeType bucket, std::set<Entry> &entries, typename std::set<Entry>::iterator entry) const
+{
+	entries.erase(entry);
+	if (entries.size() <= overflowThreshold / 2)
+	{
+		m_overflowList.erase(bucket);
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::refreshOverflowEntries(sizeType bucket, bool create) const
+{
+	if (!create && overflowEntries(bucket) == nullptr)
+	{
+		return;
+	}
+
+	std::set<Entry> entries;
+	for (sizeType current = m_bucketList[bucket].first; current != sizeLimits::max(); current = m_nodeList[current].next)
+	{
+		entries.emplace_hint(entries.end(), Entry{ m_nodeList[current].hash, current });
+	}
+
+	// Chains that became short again are searched directly.
+	if (entries.size() <= overflowThreshold / 2)
+	{
+		m_overflowList.erase(bucket);
+	}
+	else
+	{
+		m_overflowList[bucket] = std::move(entries);
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::rebuildOverflowList() const
+{
+	m_overflowList.clear();
+	if (m_selfOrganizing)
+	{
+		return;
+	}
+
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		if (chainLength(bucket) > overflowThreshold)
+		{
+			refreshOverflowEntries(bucket, true);
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline bool GenericHashContainer<sizeType, hashType>::promote(sizeType bucket, sizeType found, sizeType previous) const
+{
+	if (!m_selfOrganizing || found == sizeLimits::max() || previous == sizeLimits::max())
+	{
+		return false;
+	}
+
+	// Only every m_promoteInterval-th hit that is not at the front already modifies the chain.
+	if (++m_hitCount < m_promoteInterval)
+	{
+		return false;
+	}
+	m_hitCount = 0;
+
+	// The run starts behind previous, which can be in front of found when found is not the first node of its run.
+	const sizeType first = m_nodeList[previous].next;
+	sizeType last = first;
+	while (m_nodeList[last].next != sizeLimits::max() && m_nodeList[m_nodeList[last].next].hash == m_nodeList[found].hash)
+	{
+		last = m_nodeList[last].next;
+	}
+
+	m_nodeList[previous].next = m_nodeList[last].next;
+	m_nodeList[last].next = m_bucketList[bucket].first;
+	m_bucketList[bucket].first = first;
+	return true;
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::release(sizeType bucket, sizeType value) const
+{
+#ifndef NDEBUG
+	// It is necessary to overwrite the memory in debug mode with an
+	// invalid value to get the assertion detect invalid operations.
+	m_nodeList[value].next = sizeLimits::max();
+	m_nodeList[value].hash = hashLimits::max();
+#endif
+	setUsed(value, false);
+	--m_occupancyList[bucket / occupancyBlockSize];
+
+	// Values chosen by insert(hash) are returned to the free list.
+	if (value < m_allocatedCount)
+	{
+		m_nodeList[value].next = m_freeHead;
+		m_freeHead = value;
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::emplace(size_t hash, sizeType value) const
+{
+	assert(value != sizeLimits::max());
+	assert(m_nodeList[value].next == sizeLimits::max());
+
+	// Construct a new node but do not insert it into the bucket structure.
+	m_nodeList[value].next = low(hash) % m_bucketCount;
+	m_nodeList[value].hash = high(hash);
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::insertEmplaced(sizeType value) const
+{
+	assert(value != sizeLimits::max());
+	assert(m_nodeList[value].next != sizeLimits::max());
+
+	// When the element is already emplaced we only need to update the bucket structure.
+	link(value, linkPosition(m_nodeList[value].next, m_nodeList[value].hash));
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::SearchIterator GenericHashContainer<sizeType, hashType>::findEmplaced(sizeType pos) const
+{
+	assert(pos != sizeLimits::max());
+	assert(m_nodeList[pos].next != sizeLimits::max());
+
+	return find(m_nodeList[pos].hash, m_nodeList[pos].next);
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::Iterator GenericHashContainer<sizeType, hashType>::begin() const
+{
+	// Find the first bucket that has a valid first pointer.
+	sizeType bucket = 0;
+	while (m_bucketList[bucket].first == sizeLimits::max())
+	{
+		++bucket;
+		if (bucket == m_bucketCount)
+		{
+			return end();
+		}
+	}
+
+	return Iterator(*this, m_bucketList[bucket].first, bucket);
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::Iterator GenericHashContainer<sizeType, hashType>::end() const
+{
+	return Iterator(*this, sizeLimits::max(), 0);
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::LocalIterator GenericHashContainer<sizeType, hashType>::localBegin(sizeType index) const
+{
+	return LocalIterator(*this, m_bucketList[index].first, index);
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::LocalIterator GenericHashContainer<sizeType, hashType>::localEnd() const
+{
+	return LocalIterator(*this, sizeLimits::max(), 0);
+}
+
+template<typename sizeType, typename hashType>
+template<class Visitor>
+inline void GenericHashContainer<sizeType, hashType>::forEach(Visitor visitor) const
+{
+	forEach(BucketRange{ 0, m_bucketCount }, visitor);
+}
+
+template<typename sizeType, typename hashType>
+template<class Visitor>
+inline void GenericHashContainer<sizeType, hashType>::forEachBucket(Visitor visitor) const
+{
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		if (m_bucketCount - bucket > bucketPrefetchDistance)
+		{
+			const sizeType ahead = m_bucketList[bucket + bucketPrefetchDistance].first;
+			if (ahead != sizeLimits::max())
+			{
+				prefetchAddress(&m_nodeList[ahead]);
+			}
+		}
+
+		const sizeType first = m_bucketList[bucket].first;
+		if (first != sizeLimits::max())
+		{
+			visitor(bucket, LocalIterator(*this, first, bucket));
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+template<class Visitor>
+inline void GenericHashContainer<sizeType, hashType>::forEachValue(Visitor visitor) const
+{
+	const size_t words = usedWords();
+	for (size_t word = 0; word < words; ++word)
+	{
+		// Visit the set bits of every word from the lowest to the highest.
+		for (uint64_t bits = m_usedList[word]; bits != 0; bits &= bits - 1)
+		{
+			const sizeType value = static_cast<sizeType>(word * 64 + countTrailingZeros(bits));
+			visitor(value, m_nodeList[value].hash);
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+template<class Visitor>
+inline void GenericHashContainer<sizeType, hashType>::forEachGroup(Visitor visitor) const
+{
+	std::vector<sizeType> group;
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		sizeType current = m_bucketList[bucket].first;
+		while (current != sizeLimits::max())
+		{
+			// Collect the run of nodes that share the hash of the current node.
+			const hashType hash = m_nodeList[current].hash;
+			group.clear();
+			do
+			{
+				group.push_back(current);
+				current = m_nodeList[current].next;
+			}
+			while (current != sizeLimits::max() && m_nodeList[current].hash == hash);
+
+			visitor(bucket, hash, group.data(), group.size());
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline std::vector<typename GenericHashContainer<sizeType, hashType>::BucketRange> GenericHashContainer<sizeType, hashType>::partitions(size_t count) const
+{
+	count = std::max<size_t>(count, 1);
+
+	size_t total = 0;
+	for (size_t block = 0; block < occupancyBlocks(); ++block)
+	{
+		total += m_occupancyList[block];
+	}
+
+	std::vector<BucketRange> ranges;
+	ranges.reserve(count);
+	sizeType begin = 0;
+	sizeType end = 0;
+	size_t visited = 0;
+	for (size_t range = 1; range < count; ++range)
+	{
+		const size_t target = total * range / count;
+		while (end < m_bucketCount && visited < target)
+		{
+			// Whole blocks in front of the boundary are skipped by their count. Only the chains of the block that contains it are walked.
+			const size_t block = end / occupancyBlockSize;
+			if (end % occupancyBlockSize == 0 && visited + m_occupancyList[block] < target)
+			{
+				visited += m_occupancyList[block];
+				end = static_cast<sizeType>(std::min<size_t>(static_cast<size_t>(end) + occupancyBlockSize, m_bucketCount));
+				continue;
+			}
+
+			for (sizeType current = m_bucketList[end].first; current != sizeLimits::max(); current = m_nodeList[current].next)
+			{
+				++visited;
+			}
+			++end;
+		}
+		ranges.push_back({ begin, end });
+		begin = end;
+	}
+	ranges.push_back({ begin, m_bucketCount });
+	return ranges;
+}
+
+template<typename sizeType, typename hashType>
+template<class Visitor>
+inline void GenericHashContainer<sizeType, hashType>::forEach(const BucketRange &range, Visitor visitor) const
+{
+	for (sizeType bucket = range.begin; bucket < range.end; ++bucket)
+	{
+		// The bucket list is read sequentially, but the first nodes of the chains are scattered.
+		if (range.end - bucket > bucketPrefetchDistance)
+		{
+			const sizeType ahead = m_bucketList[bucket + bucketPrefetchDistance].first;
+			if (ahead != sizeLimits::max())
+			{
+				prefetchAddress(&m_nodeList[ahead]);
+			}
+		}
+
+		for (sizeType current = m_bucketList[bucket].first; current != sizeLimits::max(); current = m_nodeList[current].next)
+		{
+			visitor(current);
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+template<class Visitor>
+inline void GenericHashContainer<sizeType, hashType>::parallelForEach(size_t threads, Visitor visitor) const
+{
+	parallelForEach(threads, visitor, ThreadExecutor());
+}
+
+template<typename sizeType, typename hashType>
+template<class Visitor, class Executor>
+inline void GenericHashContainer<sizeType, hashType>::parallelForEach(size_t threads, Visitor visitor, Executor executor) const
+{
+	if (threads == 0)
+	{
+		threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	std::vector<std::function<void()>> tasks;
+	for (const BucketRange &range : partitions(threads))
+	{
+		if (range.begin != range.end)
+		{
+			tasks.push_back([this, range, &visitor]() { forEach(range, std::ref(visitor)); });
+		}
+	}
+	executor(tasks);
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::ThreadExecutor::operator()(std::vector<std::function<void()>> &tasks) const
+{
+	if (tasks.empty())
+	{
+		return;
+	}
+
+	// Exceptions can't leave a thread, so the first one is passed on after all threads finished.
+	std::vector<std::exception_ptr> errors(tasks.size());
+	auto run = [&tasks, &errors](size_t task)
+	{
+		try
+		{
+			tasks[task]();
+		}
+		catch (...)
+		{
+			errors[task] = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t task = 1; task < tasks.size(); ++task)
+	{
+		threads.emplace_back(run, task);
+	}
+	run(0);
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+
+	for (const std::exception_ptr &error : errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+template<class sizeType, class hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::nextMatch(sizeType current, sizeType &bucket, sizeType &previous) const
+{
+	previous = current;
+	return searchNext(m_nodeList[current].hash, m_nodeList[current].next, bucket, previous);
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::searchNext(hashType hash, sizeType current, sizeType &bucket, sizeType &previous) const
+{
+	const sizeType found = findNext(hash, current, previous);
+	if (found != sizeLimits::max())
+	{
+		return found;
+	}
+
+	// The first of both buckets is searched first, so continue with the second one.
+	const sizeType second = alternateBucket(bucket, hash);
+	if (second <= bucket)
+	{
+		return sizeLimits::max();
+	}
+
+	bucket = second;
+	const sizeType start = chainStart(bucket, hash, previous);
+	return findNext(hash, start, previous);
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::alternateBucket(sizeType bucket, hashType hash) const
+{
+	if (m_bucketChoice != TwoChoices)
+	{
+		return bucket;
+	}
+
+	// The offset only depends on the hash, so applying this twice returns the original bucket.
+	// Both buckets can therefore be computed from the hash and either of them.
+	const uint64_t offset = ((static_cast<uint64_t>(hash) + 1) * 0x9e3779b97f4a7c15ull >> 32) % m_bucketCount;
+	return static_cast<sizeType>((offset + m_bucketCount - bucket) % m_bucketCount);
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::firstBucket(sizeType bucket, hashType hash) const
+{
+	return std::min(bucket, alternateBucket(bucket, hash));
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::BucketChoice GenericHashContainer<sizeType, hashType>::bucketChoice() const
+{
+	return m_bucketChoice;
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::nodes() const
+{
+	return m_nodeCount;
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::buckets() const
+{
+	return m_bucketCount;
+}
+
+template<typename sizeType, typename hashType>
+inline hashType GenericHashContainer<sizeType, hashType>::hash(sizeType index)
+{
+	return m_nodeList[index].hash;
+}
+
+template<typename sizeType, typename hashType>
+inline std::vector<typename GenericHashContainer<sizeType, hashType>::Entry> GenericHashContainer<sizeType, hashType>::exportSorted() const
+{
+	// Walking the buckets in order already yields the entries sorted by bucket, and sorted chains are in the order of Entry.
+	std::vector<Entry> entries;
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		const size_t begin = entries.size();
+		for (sizeType current = m_bucketList[bucket].first; current != sizeLimits::max(); current = m_nodeList[current].next)
+		{
+			entries.push_back({ m_nodeList[current].hash, current });
+		}
+
+		// Only chains of the self organizing mode need to be sorted.
+		if (m_selfOrganizing && entries.size() - begin > 1)
+		{
+			std::sort(entries.begin() + begin, entries.end());
+		}
+	}
+	return entries;
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::BucketTable GenericHashContainer<sizeType, hashType>::exportBuckets() const
+{
+	BucketTable table;
+	table.offsets.reserve(static_cast<size_t>(m_bucketCount) + 1);
+	table.offsets.push_back(0);
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		for (sizeType current = m_bucketList[bucket].first; current != sizeLimits::max(); current = m_nodeList[current].next)
+		{
+			table.values.push_back(current);
+		}
+		table.offsets.push_back(static_cast<sizeType>(table.values.size()));
+	}
+	return table;
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::save(std::ostream &stream) const
+{
+	const SnapshotHeader header = snapshotHeader(snapshotMagic);
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char *>(m_bucketList.get()), sizeof(Bucket) * m_bucketCount);
+	stream.write(reinterpret_cast<const char *>(m_nodeList.get()), sizeof(Node) * m_nodeCount);
+
+	if (!stream)
+	{
+		throw std::runtime_error("HashContainer: Unable to write snapshot.");
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline GenericHashContainer<sizeType, hashType> GenericHashContainer<sizeType, hashType>::load(std::istream &stream)
+{
+	SnapshotHeader header;
+	if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header)))
+	{
+		throw std::runtime_error("HashContainer: Snapshot is truncated.");
+	}
+
+	GenericHashContainer result = fromSnapshotHeader(header, snapshotMagic);
+	stream.read(reinterpret_cast<char *>(result.m_bucketList.get()), sizeof(Bucket) * result.m_bucketCount);
+	stream.read(reinterpret_cast<char *>(result.m_nodeList.get()), sizeof(Node) * result.m_nodeCount);
+	if (!stream)
+	{
+		throw std::runtime_error("HashContainer: Snapshot is truncated.");
+	}
+
+	result.rebuildUsedList();
+	result.checkFreeList();
+	result.sortChains();
+	return result;
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::saveCompressed(std::ostream &stream) const
+{
+	std::vector<uint8_t> payload;
+	payload.reserve(m_bucketCount / 4 + m_nodeCount * (sizeof(hashType) + 1));
+
+	// Buckets are stored as pairs of the number of skipped empty buckets and the
+	// delta of the first node to the first node of the previous non-empty bucket.
+	// A trailing run of empty buckets is stored without a delta.
+	sizeType previous = 0;
+	size_t empty = 0;
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		const sizeType first = m_bucketList[bucket].first;
+		if (first == sizeLimits::max())
+		{
+			++empty;
+			continue;
+		}
+
+		writeVarint(payload, empty);
+		writeVarint(payload, zigzag(static_cast<uint64_t>(first) - previous));
+		previous = first;
+		empty = 0;
+	}
+	if (empty != 0)
+	{
+		writeVarint(payload, empty);
+	}
+
+	// Nodes store the raw hash followed by the delta of next to the node position.
+	// Zero marks the end of a chain, so every other delta is shifted by one.
+	for (sizeType node = 0; node < m_nodeCount; ++node)
+	{
+		const hashType hash = m_nodeList[node].hash;
+		payload.insert(payload.end(), reinterpret_cast<const uint8_t *>(&hash), reinterpret_cast<const uint8_t *>(&hash) + sizeof(hash));
+
+		const sizeType next = m_nodeList[node].next;
+		writeVarint(payload, next == sizeLimits::max() ? 0 : zigzag(static_cast<uint64_t>(next) - node) + 1);
+	}
+
+	const SnapshotHeader header = snapshotHeader(compressedSnapshotMagic);
+	const uint64_t payloadSize = payload.size();
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char *>(&payloadSize), sizeof(payloadSize));
+	stream.write(reinterpret_cast<const char *>(payload.data()), payload.size());
+
+	if (!stream)
+	{
+		throw std::runtime_error("HashContainer: Unable to write snapshot.");
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline GenericHashContainer<sizeType, hashType> GenericHashContainer<sizeType, hashType>::loadCompressed(std::istream &stream)
+{
+	SnapshotHeader header;
+	uint64_t payloadSize;
+	if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header)) || !stream.read(reinterpret_cast<char *>(&payloadSize), sizeof(payloadSize)))
+	{
+		throw std::runtime_error("HashContainer: Snapshot is truncated.");
+	}
+
+	GenericHashContainer result = fromSnapshotHeader(header, compressedSnapshotMagic);
+
+	// Every node needs at least its hash and one byte, which bounds a sane payload size.
+	const uint64_t maximumPayload = header.bucketCount * 20 + header.nodeCount * (sizeof(hashType) + 10);
+	if (payloadSize > maximumPayload)
+	{
+		throw std::runtime_error("HashContainer: Snapshot is corrupt.");
+	}
+
+	std::vector<uint8_t> payload(static_cast<size_t>(payloadSize));
+	if (!stream.read(reinterpret_cast<char *>(payload.data()), payload.size()))
+	{
+		throw std::runtime_error("HashContainer: Snapshot is truncated.");
+	}
+
+	const uint8_t *position = payload.data();
+	const uint8_t *end = position + payload.size();
+
+	uint64_t previous = 0;
+	uint64_t bucket = 0;
+	while (bucket < result.m_bucketCount)
+	{
+		const uint64_t empty = readVarint(position, end);
+		if (empty > result.m_bucketCount - bucket)
+		{
+			throw std::runtime_error("HashContainer: Snapshot is corrupt.");
+		}
+
+		bucket += empty;
+		if (bucket == result.m_bucketCount)
+		{
+			break;
+		}
+
+		previous += unzigzag(readVarint(position, end));
+		if (previous >= result.m_nodeCount)
+		{
+			throw std::runtime_error("HashContainer: Snapshot is corrupt.");
+		}
+		result.m_bucketList[bucket++].first = static_cast<sizeType>(previous);
+	}
+
+	for (sizeType node = 0; node < result.m_nodeCount; ++node)
+	{
+		if (static_cast<size_t>(end - position) < sizeof(hashType))
+		{
+			throw std::runtime_error("HashContainer: Snapshot is truncated.");
+		}
+		std::memcpy(&result.m_nodeList[node].hash, position, sizeof(hashType));
+		position += sizeof(hashType);
+
+		const uint64_t next = readVarint(position, end);
+		if (next == 0)
+		{
+			result.m_nodeList[node].next = sizeLimits::max();
+			continue;
+		}
+
+		// Nodes that are not linked may contain arbitrary values in release mode, so only the range is checked.
+		const uint64_t target = node + unzigzag(next - 1);
+		if (target >= sizeLimits::max())
+		{
+			throw std::runtime_error("HashContainer: Snapshot is corrupt.");
+		}
+		result.m_nodeList[node].next = static_cast<sizeType>(target);
+	}
+
+	result.rebuildUsedList();
+	result.checkFreeList();
+	result.sortChains();
+	return result;
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericHashContainer<sizeType, hashType>::SnapshotHeader GenericHashContainer<sizeType, hashType>::snapshotHeader(uint32_t magic) const
+{
+	SnapshotHeader header;
+	header.magic = magic;
+	header.version = snapshotVersion;
+	header.sizeTypeBytes = sizeof(sizeType);
+	header.hashTypeBytes = sizeof(hashType);
+	header.flags = m_bucketChoice == TwoChoices ? twoChoicesFlag : 0;
+	header.reserved = 0;
+	header.bucketCount = m_bucketCount;
+	header.nodeCount = m_nodeCount;
+	header.freeHead = m_freeHead;
+	header.allocatedCount = m_allocatedCount;
+	return header;
+}
+
+template<typename sizeType, typename hashType>
+inline GenericHashContainer<sizeType, hashType> GenericHashContainer<sizeType, hashType>::fromSnapshotHeader(const SnapshotHeader &header, uint32_t magic)
+{
+	if (header.magic != magic || header.version != snapshotVersion
+		|| header.sizeTypeBytes != sizeof(sizeType) || header.hashTypeBytes != sizeof(hashType)
+		|| (header.flags & ~twoChoicesFlag) != 0)
+	{
+		throw std::runtime_error("HashContainer: Snapshot is incompatible.");
+	}
+
+	// Containers can be created with a custom number of buckets, so only the ranges of the counts are checked.
+	if (header.nodeCount >= sizeLimits::max() || header.bucketCount > sizeLimits::max() || (header.bucketCount == 0 && header.nodeCount != 0))
+	{
+		throw std::runtime_error("HashContainer: Snapshot is incompatible.");
+	}
+	GenericHashContainer result(static_cast<size_t>(header.nodeCount), static_cast<size_t>(header.bucketCount),
+		(header.flags & twoChoicesFlag) != 0 ? TwoChoices : SingleChoice);
+
+	if (header.allocatedCount > header.nodeCount || (header.freeHead >= header.allocatedCount && header.freeHead != sizeLimits::max()))
+	{
+		throw std::runtime_error("HashContainer: Snapshot is corrupt.");
+	}
+
+	result.m_freeHead = static_cast<sizeType>(header.freeHead);
+	result.m_allocatedCount = static_cast<sizeType>(header.allocatedCount);
+	return result;
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::writeVarint(std::vector<uint8_t> &buffer, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		buffer.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back(static_cast<uint8_t>(value));
+}
+
+template<typename sizeType, typename hashType>
+inline uint64_t GenericHashContainer<sizeType, hashType>::readVarint(const uint8_t *&position, const uint8_t *end)
+{
+	// Most indices of a compressible container fit into a single byte, so check for that first.
+	if (position != end && *position < 0x80)
+	{
+		return *position++;
+	}
+
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (position == end)
+		{
+			throw std::runtime_error("HashContainer: Snapshot is truncated.");
+		}
+
+		const uint8_t byte = *position++;
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if (byte < 0x80)
+		{
+			return value;
+		}
+	}
+
+	throw std::runtime_error("HashContainer: Snapshot is corrupt.");
+}
+
+template<typename sizeType, typename hashType>
+inline uint64_t GenericHashContainer<sizeType, hashType>::zigzag(uint64_t difference)
+{
+	return (difference << 1) ^ (0 - (difference >> 63));
+}
+
+template<typename sizeType, typename hashType>
+inline uint64_t GenericHashContainer<sizeType, hashType>::unzigzag(uint64_t value)
+{
+	return (value >> 1) ^ (0 - (value & 1));
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::findNext(hashType hash, sizeType current, sizeType &previous) const
+{
+	while (current != sizeLimits::max())
+	{
+		if (m_nodeList[current].hash == hash)
+			return current;
+		if (!m_selfOrganizing && m_nodeList[current].hash > hash)
+			break;
+		previous = current;
+		current = m_nodeList[current].next;
+	}
+
+	return sizeLimits::max();
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::nextElement(sizeType current, sizeType &bucket) const
+{
+	// Iterate over a bucket.
+	if (m_nodeList[current].next != sizeLimits::max())
+	{
+		return m_nodeList[current].next;
+	}
+
+	// The end of the bucket is reached. We need to find the next bucket with a valid first pointer.
+	while (++bucket != m_bucketCount)
+	{
+		if (m_bucketList[bucket].first != sizeLimits::max())
+		{
+			return m_bucketList[bucket].first;
+		}
+	}
+
+	return std::numeric_limits<sizeType>::max();
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::prefetchNext(sizeType current, hashType hash) const
+{
+	// Nodes of the same hash are adjacent, so prefetching stops behind the run of hash.
+	if (m_nodeList[current].hash != hash)
+	{
+		return sizeLimits::max();
+	}
+
+	const sizeType next = m_nodeList[current].next;
+	if (next != sizeLimits::max())
+	{
+		prefetchAddress(&m_nodeList[next]);
+	}
+	return next;
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::prefetchBuckets(sizeType &prefetched, size_t limit) const
+{
+	limit = std::min(limit, static_cast<size_t>(m_bucketCount) - 1);
+	while (prefetched < limit)
+	{
+		const sizeType first = m_bucketList[++prefetched].first;
+		if (first != sizeLimits::max())
+		{
+			prefetchAddress(&m_nodeList[first]);
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::computeBucketCount(size_t entries)
+{
+	if (entries > maximumEntries)
+	{
+		throw std::runtime_error("HashContainer: Size is too large.");
+	}
+	return static_cast<sizeType>(bucketFactor * entries);
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericHashContainer<sizeType, hashType>::checkBucketCount(size_t entries, size_t buckets)
+{
+	// The maximum of sizeType marks the end of a chain, so it can not be a value.
+	if (entries >= sizeLimits::max() || buckets > sizeLimits::max())
+	{
+		throw std::runtime_error("HashContainer: Size is too large.");
+	}
+	if (buckets == 0 && entries != 0)
+	{
+		throw std::runtime_error("HashContainer: A container with entries needs a bucket.");
+	}
+	return static_cast<sizeType>(buckets);
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::prefetchAddress(const void *address)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+#else
+	(void)address;
+#endif
+}
+
+template<typename sizeType, typename hashType>
+inline unsigned GenericHashContainer<sizeType, hashType>::countTrailingZeros(uint64_t word)
+{
+	assert(word != 0);
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return static_cast<unsigned>(index);
+#else
+	unsigned index = 0;
+	while ((word & 1) == 0)
+	{
+		word >>= 1;
+		++index;
+	}
+	return index;
+#endif
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::setUsed(sizeType value, bool used) const
+{
+	const uint64_t mask = uint64_t(1) << (value % 64);
+	if (used)
+	{
+		m_usedList[value / 64] |= mask;
+	}
+	else
+	{
+		m_usedList[value / 64] &= ~mask;
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::rebuildUsedList() const
+{
+	std::memset(m_usedList.get(), 0, sizeof(uint64_t) * usedWords());
+	std::memset(m_occupancyList.get(), 0, sizeof(sizeType) * occupancyBlocks());
+
+	// Every node can only be part of one chain, so more steps than nodes mean that a chain contains a cycle.
+	size_t steps = 0;
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		for (sizeType current = m_bucketList[bucket].first; current != sizeLimits::max(); current = m_nodeList[current].next)
+		{
+			if (current >= m_nodeCount || ++steps > m_nodeCount)
+			{
+				throw std::runtime_error("HashContainer: Snapshot is corrupt.");
+			}
+			setUsed(current, true);
+			++m_occupancyList[bucket / occupancyBlockSize];
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::checkFreeList() const
+{
+	// Only values below m_allocatedCount are returned to the free list, so it is longer than that when it contains a cycle.
+	sizeType steps = 0;
+	for (sizeType current = m_freeHead; current != sizeLimits::max(); current = m_nodeList[current].next)
+	{
+		if (current >= m_allocatedCount || ((m_usedList[current / 64] >> (current % 64)) & 1) != 0 || ++steps > m_allocatedCount)
+		{
+			throw std::runtime_error("HashContainer: Snapshot is corrupt.");
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericHashContainer<sizeType, hashType>::sortChains() const
+{
+	for (sizeType bucket = 0; bucket < m_bucketCount; ++bucket)
+	{
+		sizeType current = m_bucketList[bucket].first;
+		while (current != sizeLimits::max() && m_nodeList[current].next != sizeLimits::max() && precedes(current, m_nodeList[current].next))
+		{
+			current = m_nodeList[current].next;
+		}
+
+		// Most chains are sorted already. Only the others are rebuilt by an insertion sort.
+		if (current == sizeLimits::max() || m_nodeList[current].next == sizeLimits::max())
+		{
+			continue;
+		}
+
+		sizeType sorted = sizeLimits::max();
+		current = m_bucketList[bucket].first;
+		while (current != sizeLimits::max())
+		{
+			const sizeType next = m_nodeList[current].next;
+			sizeType *position = &sorted;
+			while (*position != sizeLimits::max() && precedes(*position, current))
+			{
+				position = &m_nodeList[*position].next;
+			}
+
+			m_nodeList[current].next = *position;
+			*position = current;
+			current = next;
+		}
+		m_bucketList[bucket].first = sorted;
+	}
+
+	rebuildOverflowList();
+}
+
+template<typename sizeType, typename hashType>
+inline bool GenericHashContainer<sizeType, hashType>::precedes(sizeType left, sizeType right) const
+{
+	return m_nodeList[left].hash != m_nodeList[right].hash ? m_nodeList[left].hash < m_nodeList[right].hash : left < right;
+}
+
+template<typename sizeType, typename hashType>
+inline size_t GenericHashContainer<sizeType, hashType>::usedWords() const
+{
+	return (static_cast<size_t>(m_nodeCount) + 63) / 64;
+}
+
+template<typename sizeType, typename hashType>
+inline size_t GenericHashContainer<sizeType, hashType>::occupancyBlocks() const
+{
+	return (static_cast<size_t>(m_bucketCount) + occupancyBlockSize - 1) / occupancyBlockSize;
 }
 
 template<typename sizeType, typename hashType>
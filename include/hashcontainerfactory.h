@@ -0,0 +1,201 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+
+#include "hashcontainer.h"
+
+//! @short Maps a number of bytes to the unsigned integral of that size.
+template<size_t bytes>
+struct UnsignedOfSize;
+
+template<> struct UnsignedOfSize<1> { using type = uint8_t; };
+template<> struct UnsignedOfSize<2> { using type = uint16_t; };
+template<> struct UnsignedOfSize<4> { using type = uint32_t; };
+template<> struct UnsignedOfSize<8> { using type = uint64_t; };
+
+//! @short Describes the types and sizes of a GenericHashContainer.
+struct HashContainerShape
+{
+	size_t sizeTypeBytes;
+	size_t hashTypeBytes;
+	size_t entries;
+	size_t buckets;
+};
+
+//! @short The HashContainerLayout computes the memory layout of GenericHashContainer instantiations.
+//! Types are described by their size in bytes, so the functions can be used at compile time and at runtime.
+struct HashContainerLayout
+{
+	//! @short Returns the size of the Node of a container.
+	static constexpr size_t nodeBytes(size_t sizeTypeBytes, size_t hashTypeBytes);
+
+	//! @short Returns the narrowest sizeType that can hold capacity entries.
+	//! @return __0__ when no sizeType is large enough.
+	static constexpr size_t sizeTypeBytes(uint64_t capacity);
+
+	//! @short Returns the hashType with the fewest bytes per entry that reaches a false positive rate.
+	//! A search in a full container returns on average 1 / (bucketFactor * 2^bits) values of other hashes.
+	//! When a wider hashType fits into the padding of the Node, it is preferred since it lowers the rate for free.
+	//! @param inverseFalsePositiveRate : The false positive rate is 1 / inverseFalsePositiveRate.
+	//! @return __0__ when no hashType reaches the rate.
+	static constexpr size_t hashTypeBytes(size_t sizeTypeBytes, uint64_t inverseFalsePositiveRate);
+
+	//! @short Returns the number of bytes of the bucket, node, used value and occupancy arrays of a container.
+	static uint64_t bytes(const HashContainerShape &shape);
+
+	//! @short Returns the shape with the most entries whose arrays fit into a budget.
+	//! Every combination of types is tried with the smallest number of buckets that reaches the false positive rate.
+	//! A search in a full container returns on average entries / (buckets * 2^bits) values of other hashes.
+	//! @param budget : Number of bytes the arrays of the container may use.
+	//! @param inverseFalsePositiveRate : The false positive rate is 1 / inverseFalsePositiveRate.
+	//! @param minimumBucketFactor : The container has at least this many buckets per entry. Values below 1 result in long chains.
+	//! @return __Shape without entries__ when not even a single entry fits.
+	static HashContainerShape fitBudget(uint64_t budget, uint64_t inverseFalsePositiveRate, double minimumBucketFactor = 1);
+};
+
+//! @short Selects the GenericHashContainer with the fewest bytes per entry at compile time.
+//! @param capacity : Maximum number of entries the container must hold.
+//! @param inverseFalsePositiveRate : A search in a full container returns at most 1 / inverseFalsePositiveRate values of other hashes on average.
+template<uint64_t capacity, uint64_t inverseFalsePositiveRate = 65536>
+struct HashContainerSelector
+{
+	static_assert(HashContainerLayout::sizeTypeBytes(capacity) != 0, "HashContainerSelector: Capacity is too large.");
+	static_assert(HashContainerLayout::hashTypeBytes(HashContainerLayout::sizeTypeBytes(capacity), inverseFalsePositiveRate) != 0,
+		"HashContainerSelector: False positive rate is too small.");
+
+	using sizeType = typename UnsignedOfSize<HashContainerLayout::sizeTypeBytes(capacity)>::type;
+	using hashType = typename UnsignedOfSize<HashContainerLayout::hashTypeBytes(sizeof(sizeType), inverseFalsePositiveRate)>::type;
+	using type = GenericHashContainer<sizeType, hashType>;
+};
+
+//! @short The GenericHashContainer selected by HashContainerSelector.
+template<uint64_t capacity, uint64_t inverseFalsePositiveRate = 65536>
+using AutoHashContainer = typename HashContainerSelector<capacity, inverseFalsePositiveRate>::type;
+
+//! @short The AnyHashContainer class holds a GenericHashContainer whose types are selected at runtime.
+//! Values and hashes are passed as size_t, so the same code can work with every instantiation.
+//! Use target to access the full interface of the held container.
+class AnyHashContainer
+{
+public:
+	//! @short Creates the container with the fewest bytes per entry. See HashContainerSelector.
+	//! @param capacity : Maximum number of entries the container must hold.
+	//! @param falsePositiveRate : A search in a full container returns at most this many values of other hashes on average.
+	//! @throw std::runtime_error when the capacity is too large or the false positive rate is too small.
+	static AnyHashContainer create(size_t capacity, double falsePositiveRate = 1.0 / 65536);
+
+	//! @short Creates the container with the most entries whose arrays fit into a memory budget. See HashContainerLayout::fitBudget.
+	//! @param bytes : Number of bytes the bucket, node and used value arrays may use.
+	//! @param falsePositiveRate : A search in a full container returns at most this many values of other hashes on average.
+	//! @param minimumBucketFactor : The container has at least this many buckets per entry.
+	//! @throw std::runtime_error when the budget is too small or the false positive rate is too small.
+	static AnyHashContainer createForBudget(size_t bytes, double falsePositiveRate = 1.0 / 65536, double minimumBucketFactor = 1);
+
+	//! @short Creates a container of a shape.
+	//! @throw std::runtime_error when a type size is not supported or a size does not fit into its type.
+	static AnyHashContainer create(const HashContainerShape &shape);
+
+	//! @short Construct a handle that holds a container.
+	//! @param container : Any instantiation of GenericHashContainer.
+	template<class Container>
+	explicit AnyHashContainer(Container container);
+
+	//! @short Construct a copy of the held container.
+	AnyHashContainer(const AnyHashContainer &other);
+
+	//! @short Construct a handle invalidating the other instance.
+	AnyHashContainer(AnyHashContainer &&other) = default;
+
+	//! @short Assigns this instance with another handle.
+	AnyHashContainer& operator=(AnyHashContainer other);
+
+	//! @short Swaps this instance with another.
+	void swap(AnyHashContainer &other);
+
+	//! @short Inserts a hash value pair. See GenericHashContainer::insert.
+	void insert(size_t hash, size_t value) const;
+
+	//! @short Inserts a hash and chooses an unused value for it. See GenericHashContainer::insert.
+	//! @return __value__ associated with the hash.
+	//! @return __std::numeric_limits<size_t>::max()__ when every value is in use.
+	size_t insert(size_t hash) const;
+
+	//! @short Removes a hash value pair. See GenericHashContainer::remove.
+	void remove(size_t hash, size_t value) const;
+
+	//! @short Removes all entries.
+	void clear() const;
+
+	//! @short Calls a visitor for every value with the same hash.
+	//! @param visitor : Callable that receives the value.
+	void find(size_t hash, const std::function<void(size_t)> &visitor) const;
+
+	//! @short Checks whether a hash value pair is part of the container.
+	bool contains(size_t hash, size_t value) const;
+
+	//! @short Returns the number of nodes, which is the capacity of the container.
+	size_t nodes() const;
+
+	//! @short Returns the number of buckets.
+	size_t buckets() const;
+
+	//! @short Returns the size of the selected sizeType.
+	size_t sizeTypeBytes() const;
+
+	//! @short Returns the size of the selected hashType.
+	size_t hashTypeBytes() const;
+
+	//! @short Returns the number of bytes of the bucket, node and used value arrays. See HashContainerLayout::bytes.
+	uint64_t bytes() const;
+
+	//! @short Writes a snapshot of the held container. See GenericHashContainer::save.
+	void save(std::ostream &stream) const;
+
+	//! @short Accessor for the held container.
+	//! @return __Pointer to the container__ when it is of type Container.
+	//! @return __nullptr__ otherwise.
+	template<class Container>
+	Container *target();
+
+	//! @short Accessor for the held container.
+	//! @return __Pointer to the container__ when it is of type Container.
+	//! @return __nullptr__ otherwise.
+	template<class Container>
+	const Container *target() const;
+
+protected:
+	//! @short Interface of the held container.
+	struct Concept
+	{
+		virtual ~Concept() = default;
+		virtual std::unique_ptr<Concept> clone() const = 0;
+		virtual void insert(size_t hash, size_t value) const = 0;
+		virtual size_t insert(size_t hash) const = 0;
+		virtual void remove(size_t hash, size_t value) const = 0;
+		virtual void clear() const = 0;
+		virtual void find(size_t hash, const std::function<void(size_t)> &visitor) const = 0;
+		virtual bool contains(size_t hash, size_t value) const = 0;
+		virtual size_t nodes() const = 0;
+		virtual size_t buckets() const = 0;
+		virtual size_t sizeTypeBytes() const = 0;
+		virtual size_t hashTypeBytes() const = 0;
+		virtual void save(std::ostream &stream) const = 0;
+	};
+
+	//! @short Implements the interface for a GenericHashContainer.
+	template<class Container>
+	struct Model;
+
+	//! @short Creates a handle for a sizeType and the hashType of a shape.
+	template<class sizeType>
+	static AnyHashContainer createWith(const HashContainerShape &shape);
+
+	//! @short Converts a false positive rate to the inverse used by HashContainerLayout.
+	//! @throw std::runtime_error when the rate is not positive.
+	static uint64_t inverseRate(double falsePositiveRate);
+
+	std::unique_ptr<Concept> m_container;
+};
+
+#include "hashcontainerfactory.hpp"
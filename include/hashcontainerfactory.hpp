@@ -0,0 +1,332 @@
+#include <cmath>
+
+inline constexpr size_t HashContainerLayout::nodeBytes(size_t sizeTypeBytes, size_t hashTypeBytes)
+{
+	// The Node stores the hash first, so the next member is aligned to its own size and the whole Node to the larger member.
+	const size_t alignment = std::max(sizeTypeBytes, hashTypeBytes);
+	const size_t next = (hashTypeBytes + sizeTypeBytes - 1) / sizeTypeBytes * sizeTypeBytes;
+	return (next + sizeTypeBytes + alignment - 1) / alignment * alignment;
+}
+
+inline constexpr size_t HashContainerLayout::sizeTypeBytes(uint64_t capacity)
+{
+	// Mirrors GenericHashContainer::maximumEntries, which can not be instantiated for a sizeType larger than size_t.
+	for (size_t bytes = 1; bytes <= sizeof(size_t); bytes *= 2)
+	{
+		const uint64_t limit = bytes == sizeof(uint64_t) ? std::numeric_limits<uint64_t>::max() : (uint64_t(1) << (bytes * 8)) - 1;
+		if (capacity <= limit / HashContainer::bucketFactor - 1)
+		{
+			return bytes;
+		}
+	}
+	return 0;
+}
+
+inline constexpr size_t HashContainerLayout::hashTypeBytes(size_t sizeTypeBytes, uint64_t inverseFalsePositiveRate)
+{
+	// A full container holds 1 / bucketFactor entries per bucket, and every entry matches with a probability of 2^-bits.
+	size_t bytes = 1;
+	while (bytes < sizeof(size_t) && (uint64_t(1) << (bytes * 8)) * HashContainer::bucketFactor < inverseFalsePositiveRate)
+	{
+		bytes *= 2;
+	}
+	if (bytes == sizeof(size_t))
+	{
+		return 0;
+	}
+
+	while (bytes * 2 < sizeof(size_t) && nodeBytes(sizeTypeBytes, bytes * 2) == nodeBytes(sizeTypeBytes, bytes))
+	{
+		bytes *= 2;
+	}
+	return bytes;
+}
+
+inline uint64_t HashContainerLayout::bytes(const HashContainerShape &shape)
+{
+	const uint64_t usedWords = (static_cast<uint64_t>(shape.entries) + 63) / 64;
+	const uint64_t occupancyBlocks = (static_cast<uint64_t>(shape.buckets) + HashContainer::occupancyBlockSize - 1) / HashContainer::occupancyBlockSize;
+	return static_cast<uint64_t>(shape.entries) * nodeBytes(shape.sizeTypeBytes, shape.hashTypeBytes)
+		+ (static_cast<uint64_t>(shape.buckets) + occupancyBlocks) * shape.sizeTypeBytes + usedWords * sizeof(uint64_t);
+}
+
+inline HashContainerShape HashContainerLayout::fitBudget(uint64_t budget, uint64_t inverseFalsePositiveRate, double minimumBucketFactor)
+{
+	HashContainerShape best = { 1, 1, 0, 0 };
+	for (size_t sizeBytes = 1; sizeBytes <= sizeof(size_t); sizeBytes *= 2)
+	{
+		for (size_t hashBytes = 1; hashBytes < sizeof(size_t); hashBytes *= 2)
+		{
+			// Every entry matches with a probability of 2^-bits, so more buckets make up for a narrower hash.
+			const double factor = std::max({ minimumBucketFactor, 1.0, static_cast<double>(inverseFalsePositiveRate) / std::ldexp(1.0, static_cast<int>(hashBytes * 8)) });
+			const double entryBytes = nodeBytes(sizeBytes, hashBytes) + factor * sizeBytes + 1.0 / 8;
+
+			// The maximum of sizeType marks the end of a chain, see GenericHashContainer::checkBucketCount.
+			const double limit = sizeBytes == sizeof(uint64_t) ? static_cast<double>(std::numeric_limits<uint64_t>::max()) : std::ldexp(1.0, static_cast<int>(sizeBytes * 8)) - 1;
+			const double entries = std::min({ std::floor(static_cast<double>(budget) / entryBytes), limit - 1, std::floor(limit / factor) });
+
+			// The estimate ignores the rounding of the buckets, the used value bitmap and the occupancy counters, so it can exceed the budget slightly.
+			HashContainerShape shape = { sizeBytes, hashBytes, static_cast<size_t>(entries), 0 };
+			for (;;)
+			{
+				shape.buckets = static_cast<size_t>(std::ceil(shape.entries * factor));
+				if (shape.entries == 0 || bytes(shape) <= budget)
+				{
+					break;
+				}
+				--shape.entries;
+			}
+
+			// A narrower sizeType or a wider hashType is preferred for the same number of entries.
+			if (shape.entries > best.entries || (shape.entries == best.entries && shape.entries != 0 && shape.sizeTypeBytes == best.sizeTypeBytes))
+			{
+				best = shape;
+			}
+		}
+	}
+	return best;
+}
+
+template<class Container>
+struct AnyHashContainer::Model : AnyHashContainer::Concept
+{
+	using sizeType = typename Container::sizeType;
+
+	explicit Model(Container container) : m_container(std::move(container)) {}
+
+	std::unique_ptr<Concept> clone() const override
+	{
+		return std::make_unique<Model>(m_container);
+	}
+
+	void insert(size_t hash, size_t value) const override
+	{
+		assert(value < m_container.nodes());
+		m_container.insert(hash, static_cast<sizeType>(value));
+	}
+
+	size_t insert(size_t hash) const override
+	{
+		const sizeType value = m_container.insert(hash);
+		return value != Container::sizeLimits::max() ? value : std::numeric_limits<size_t>::max();
+	}
+
+	void remove(size_t hash, size_t value) const override
+	{
+		assert(value < m_container.nodes());
+		m_container.remove(hash, static_cast<sizeType>(value));
+	}
+
+	void clear() const override
+	{
+		m_container.clear();
+	}
+
+	void find(size_t hash, const std::function<void(size_t)> &visitor) const override
+	{
+		for (auto it = m_container.find(hash); it; ++it)
+		{
+			visitor(*it);
+		}
+	}
+
+	bool contains(size_t hash, size_t value) const override
+	{
+		return value < m_container.nodes() && m_container.findIf(hash, [value](sizeType current) { return current == value; });
+	}
+
+	size_t nodes() const override
+	{
+		return m_container.nodes();
+	}
+
+	size_t buckets() const override
+	{
+		return m_container.buckets();
+	}
+
+	size_t sizeTypeBytes() const override
+	{
+		return sizeof(sizeType);
+	}
+
+	size_t hashTypeBytes() const override
+	{
+		return sizeof(typename Container::hashType);
+	}
+
+	void save(std::ostream &stream) const override
+	{
+		m_container.save(stream);
+	}
+
+	Container m_container;
+};
+
+inline AnyHashContainer AnyHashContainer::create(size_t capacity, double falsePositiveRate)
+{
+	const uint64_t inverse = inverseRate(falsePositiveRate);
+	const size_t sizeBytes = HashContainerLayout::sizeTypeBytes(capacity);
+	if (sizeBytes == 0)
+	{
+		throw std::runtime_error("HashContainer: Size is too large.");
+	}
+	const size_t hashBytes = HashContainerLayout::hashTypeBytes(sizeBytes, inverse);
+	if (hashBytes == 0)
+	{
+		throw std::runtime_error("HashContainer: False positive rate is too small.");
+	}
+
+	return create(HashContainerShape{ sizeBytes, hashBytes, capacity, capacity * HashContainer::bucketFactor });
+}
+
+inline AnyHashContainer AnyHashContainer::createForBudget(size_t bytes, double falsePositiveRate, double minimumBucketFactor)
+{
+	const HashContainerShape shape = HashContainerLayout::fitBudget(bytes, inverseRate(falsePositiveRate), minimumBucketFactor);
+	if (shape.entries == 0)
+	{
+		throw std::runtime_error("HashContainer: Budget is too small.");
+	}
+	return create(shape);
+}
+
+inline AnyHashContainer AnyHashContainer::create(const HashContainerShape &shape)
+{
+	switch (shape.sizeTypeBytes)
+	{
+	case 1:
+		return createWith<uint8_t>(shape);
+	case 2:
+		return createWith<uint16_t>(shape);
+	case 4:
+		return createWith<uint32_t>(shape);
+	case 8:
+		return createWith<uint64_t>(shape);
+	default:
+		throw std::runtime_error("HashContainer: Type size is not supported.");
+	}
+}
+
+template<class sizeType>
+inline AnyHashContainer AnyHashContainer::createWith(const HashContainerShape &shape)
+{
+	switch (shape.hashTypeBytes)
+	{
+	case 1:
+		return AnyHashContainer(GenericHashContainer<sizeType, uint8_t>(shape.entries, shape.buckets));
+	case 2:
+		return AnyHashContainer(GenericHashContainer<sizeType, uint16_t>(shape.entries, shape.buckets));
+	case 4:
+		return AnyHashContainer(GenericHashContainer<sizeType, uint32_t>(shape.entries, shape.buckets));
+	default:
+		throw std::runtime_error("HashContainer: Type size is not supported.");
+	}
+}
+
+inline uint64_t AnyHashContainer::inverseRate(double falsePositiveRate)
+{
+	if (!(falsePositiveRate > 0))
+	{
+		throw std::runtime_error("HashContainer: False positive rate is too small.");
+	}
+
+	// Rates above 1 are reached by any hashType. The inverse is clamped to stay representable, no hashType reaches such a rate anyway.
+	const double inverse = std::ceil(1 / falsePositiveRate);
+	return inverse < 1e18 ? static_cast<uint64_t>(inverse) : uint64_t(1e18);
+}
+
+template<class Container>
+inline AnyHashContainer::AnyHashContainer(Container container)
+	: m_container(std::make_unique<Model<Container>>(std::move(container)))
+{
+}
+
+inline AnyHashContainer::AnyHashContainer(const AnyHashContainer &other)
+	: m_container(other.m_container->clone())
+{
+}
+
+inline AnyHashContainer& AnyHashContainer::operator=(AnyHashContainer other)
+{
+	swap(other);
+	return *this;
+}
+
+inline void AnyHashContainer::swap(AnyHashContainer &other)
+{
+	std::swap(m_container, other.m_container);
+}
+
+inline void AnyHashContainer::insert(size_t hash, size_t value) const
+{
+	m_container->insert(hash, value);
+}
+
+inline size_t AnyHashContainer::insert(size_t hash) const
+{
+	return m_container->insert(hash);
+}
+
+inline void AnyHashContainer::remove(size_t hash, size_t value) const
+{
+	m_container->remove(hash, value);
+}
+
+inline void AnyHashContainer::clear() const
+{
+	m_container->clear();
+}
+
+inline void AnyHashContainer::find(size_t hash, const std::function<void(size_t)> &visitor) const
+{
+	m_container->find(hash, visitor);
+}
+
+inline bool AnyHashContainer::contains(size_t hash, size_t value) const
+{
+	return m_container->contains(hash, value);
+}
+
+inline size_t AnyHashContainer::nodes() const
+{
+	return m_container->nodes();
+}
+
+inline size_t AnyHashContainer::buckets() const
+{
+	return m_container->buckets();
+}
+
+inline size_t AnyHashContainer::sizeTypeBytes() const
+{
+	return m_container->sizeTypeBytes();
+}
+
+inline size_t AnyHashContainer::hashTypeBytes() const
+{
+	return m_container->hashTypeBytes();
+}
+
+inline uint64_t AnyHashContainer::bytes() const
+{
+	return HashContainerLayout::bytes(HashContainerShape{ sizeTypeBytes(), hashTypeBytes(), nodes(), buckets() });
+}
+
+inline void AnyHashContainer::save(std::ostream &stream) const
+{
+	m_container->save(stream);
+}
+
+template<class Container>
+inline Container *AnyHashContainer::target()
+{
+	Model<Container> *model = dynamic_cast<Model<Container> *>(m_container.get());
+	return model != nullptr ? &model->m_container : nullptr;
+}
+
+template<class Container>
+inline const Container *AnyHashContainer::target() const
+{
+	const Model<Container> *model = dynamic_cast<const Model<Container> *>(m_container.get());
+	return model != nullptr ? &model->m_container : nullptr;
+}
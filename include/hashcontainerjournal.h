@@ -0,0 +1,108 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "hashcontainer.h"
+
+//! @short The HashContainerJournal template persists a container incrementally.
+//! Every mutation is applied to the container and appended as a compact record to a journal file.
+//! Records are buffered and written as a group, and the container is periodically checkpointed
+//! to a snapshot so the journal stays short. After a restart recover loads the last snapshot
+//! and replays the journal tail instead of rebuilding the container from scratch.
+//! The snapshot file stores a generation number followed by the container snapshot. The journal
+//! file starts with the generation of the snapshot it applies to, so a journal that was not truncated
+//! because of a crash during checkpoint is never replayed twice.
+//! Committed records and checkpoints are synchronized to the storage device, so they survive a power failure.
+//! @remark This class requires a POSIX system.
+template<typename container_t>
+class HashContainerJournal
+{
+public:
+	using Container = container_t;
+	using sizeType = typename Container::sizeType;
+
+	//! @short Construct a journal for a container.
+	//! When no snapshot exists yet an initial checkpoint is written. Otherwise the container
+	//! is expected to be the one returned by recover for the same files.
+	//! A torn record at the end of the journal is cut off, so new records directly follow the last complete one.
+	//! @param container : The container to persist. It must outlive the journal.
+	//! @param snapshotPath : The file the checkpoints are written to.
+	//! @param journalPath : The file the records are appended to.
+	//! @param groupSize : Number of records that are buffered before they are written to the journal.
+	//! @param checkpointInterval : Number of records after which a checkpoint is taken automatically.
+	HashContainerJournal(Container &container, std::string snapshotPath, std::string journalPath, size_t groupSize = 64, size_t checkpointInterval = 1 << 20);
+
+	//! @short Commits all pending records.
+	~HashContainerJournal();
+
+	HashContainerJournal(const HashContainerJournal &other) = delete;
+	HashContainerJournal& operator=(const HashContainerJournal &other) = delete;
+
+	//! @short Inserts a hash value pair into the container and records it.
+	void insert(size_t hash, sizeType value);
+
+	//! @short Inserts a hash into the container, which chooses an unused value, and records it.
+	//! @return __value__ associated with the hash or __sizeLimits::max()__ when every value is in use.
+	sizeType insert(size_t hash);
+
+	//! @short Removes a hash value pair from the container and records it.
+	void remove(size_t hash, sizeType value);
+
+	//! @short Removes the content of the container and records it.
+	void clear();
+
+	//! @short Writes all pending records to the journal file and waits until they reached the storage device.
+	void commit();
+
+	//! @short Writes the container to the snapshot file and truncates the journal.
+	void checkpoint();
+
+	//! @short Reconstructs a container from a snapshot and the journal that belongs to it.
+	//! A missing journal or a torn record at its end is tolerated. Records that were never committed are lost.
+	//! @param journalLength : Receives the size of the journal up to the end of the last complete record, or 0 when the journal was not replayed.
+	//! @throw std::runtime_error when the snapshot can not be read or the journal contains an invalid record.
+	static Container recover(const std::string &snapshotPath, const std::string &journalPath, uint64_t *journalLength = nullptr);
+
+protected:
+	enum Operation : uint8_t
+	{
+		Insert = 0,
+		Remove = 1,
+		Clear = 2,
+		Allocate = 3
+	};
+
+	//! @short Appends a record to the pending group and commits or checkpoints when necessary.
+	void append(Operation operation, size_t hash, sizeType value);
+
+	//! @short Truncates the journal file and starts it with the current generation.
+	void resetJournal();
+
+	//! @short Reads the records of a journal that follow its generation.
+	//! @param container : Receives the records when apply is set. Values are checked against its size in any case.
+	//! @return __Offset__ behind the last complete record.
+	//! @throw std::runtime_error when a record is invalid.
+	static uint64_t replay(std::istream &journal, const Container &container, bool apply);
+
+	//! @short Waits until the content of a file or directory reached the storage device.
+	static void synchronize(const std::string &path);
+
+	//! @short Returns the directory that contains a file.
+	static std::string directoryOf(const std::string &path);
+
+	Container &m_container;
+	std::string m_snapshotPath;
+	std::string m_journalPath;
+	size_t m_groupSize;
+	size_t m_checkpointInterval;
+
+	uint64_t m_generation;
+	size_t m_pendingRecords;
+	size_t m_recordsSinceCheckpoint;
+	std::vector<char> m_pending;
+	std::ofstream m_journal;
+};
+
+#include "hashcontainerjournal.hpp"
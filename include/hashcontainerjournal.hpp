@@ -0,0 +1,304 @@
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+template<typename container_t>
+HashContainerJournal<container_t>::HashContainerJournal(Container &container, std::string snapshotPath, std::string journalPath, size_t groupSize, size_t checkpointInterval)
+	: m_container(container)
+	, m_snapshotPath(std::move(snapshotPath))
+	, m_journalPath(std::move(journalPath))
+	, m_groupSize(std::max<size_t>(groupSize, 1))
+	, m_checkpointInterval(std::max<size_t>(checkpointInterval, 1))
+	, m_generation(0)
+	, m_pendingRecords(0)
+	, m_recordsSinceCheckpoint(0)
+{
+	std::ifstream snapshot(m_snapshotPath, std::ios::binary);
+	if (!snapshot.read(reinterpret_cast<char *>(&m_generation), sizeof(m_generation)))
+	{
+		// Without a snapshot the journal would have nothing to be replayed on.
+		snapshot.close();
+		checkpoint();
+		return;
+	}
+
+	// Continue the existing journal when it belongs to the current snapshot.
+	std::ifstream journal(m_journalPath, std::ios::binary);
+	uint64_t journalGeneration;
+	if (!journal.read(reinterpret_cast<char *>(&journalGeneration), sizeof(journalGeneration)) || journalGeneration != m_generation)
+	{
+		journal.close();
+		resetJournal();
+		return;
+	}
+
+	// Appending behind a torn record would make the following records unreadable.
+	const uint64_t length = replay(journal, m_container, false);
+	journal.close();
+	if (::truncate(m_journalPath.c_str(), static_cast<off_t>(length)) != 0)
+	{
+		throw std::runtime_error("HashContainerJournal: Unable to write journal.");
+	}
+
+	m_journal.open(m_journalPath, std::ios::binary | std::ios::app);
+	if (!m_journal)
+	{
+		throw std::runtime_error("HashContainerJournal: Unable to write journal.");
+	}
+}
+
+template<typename container_t>
+HashContainerJournal<container_t>::~HashContainerJournal()
+{
+	try
+	{
+		commit();
+	}
+	catch (...)
+	{
+		// Destructors must not throw. Uncommitted records are lost just like after a crash.
+	}
+}
+
+template<typename container_t>
+inline void HashContainerJournal<container_t>::insert(size_t hash, sizeType value)
+{
+	m_container.insert(hash, value);
+	append(Insert, hash, value);
+}
+
+template<typename container_t>
+inline typename HashContainerJournal<container_t>::sizeType HashContainerJournal<container_t>::insert(size_t hash)
+{
+	const sizeType value = m_container.insert(hash);
+	if (value != Container::sizeLimits::max())
+	{
+		append(Allocate, hash, value);
+	}
+	return value;
+}
+
+template<typename container_t>
+inline void HashContainerJournal<container_t>::remove(size_t hash, sizeType value)
+{
+	m_container.remove(hash, value);
+	append(Remove, hash, value);
+}
+
+template<typename container_t>
+inline void HashContainerJournal<container_t>::clear()
+{
+	m_container.clear();
+	append(Clear, 0, 0);
+}
+
+template<typename container_t>
+inline void HashContainerJournal<container_t>::commit()
+{
+	if (m_pending.empty())
+	{
+		return;
+	}
+
+	m_journal.write(m_pending.data(), m_pending.size());
+	m_journal.flush();
+	if (!m_journal)
+	{
+		throw std::runtime_error("HashContainerJournal: Unable to write journal.");
+	}
+	synchronize(m_journalPath);
+
+	m_pending.clear();
+	m_pendingRecords = 0;
+}
+
+template<typename container_t>
+inline void HashContainerJournal<container_t>::checkpoint()
+{
+	// Write to a temporary file first so a crash never leaves a partial snapshot behind.
+	const std::string temporaryPath = m_snapshotPath + ".tmp";
+	{
+		std::ofstream snapshot(temporaryPath, std::ios::binary | std::ios::trunc);
+		const uint64_t generation = m_generation + 1;
+		snapshot.write(reinterpret_cast<const char *>(&generation), sizeof(generation));
+		m_container.save(snapshot);
+		snapshot.flush();
+		if (!snapshot)
+		{
+			throw std::runtime_error("HashContainerJournal: Unable to write snapshot.");
+		}
+	}
+	synchronize(temporaryPath);
+
+	if (std::rename(temporaryPath.c_str(), m_snapshotPath.c_str()) != 0)
+	{
+		throw std::runtime_error("HashContainerJournal: Unable to replace snapshot.");
+	}
+	synchronize(directoryOf(m_snapshotPath));
+
+	// Pending records are part of the container state and therefore part of the snapshot.
+	// They are only dropped now, so a failed checkpoint still commits them to the old journal.
+	m_pending.clear();
+	m_pendingRecords = 0;
+	m_recordsSinceCheckpoint = 0;
+
+	++m_generation;
+	resetJournal();
+}
+
+template<typename container_t>
+inline typename HashContainerJournal<container_t>::Container HashContainerJournal<container_t>::recover(const std::string &snapshotPath, const std::string &journalPath, uint64_t *journalLength)
+{
+	if (journalLength != nullptr)
+	{
+		*journalLength = 0;
+	}
+
+	std::ifstream snapshot(snapshotPath, std::ios::binary);
+	uint64_t generation;
+	if (!snapshot.read(reinterpret_cast<char *>(&generation), sizeof(generation)))
+	{
+		throw std::runtime_error("HashContainerJournal: Unable to read snapshot.");
+	}
+
+	Container container = Container::load(snapshot);
+
+	std::ifstream journal(journalPath, std::ios::binary);
+	uint64_t journalGeneration;
+	if (!journal.read(reinterpret_cast<char *>(&journalGeneration), sizeof(journalGeneration)) || journalGeneration != generation)
+	{
+		// The journal is missing or was superseded by the snapshot.
+		return container;
+	}
+
+	const uint64_t length = replay(journal, container, true);
+	if (journalLength != nullptr)
+	{
+		*journalLength = length;
+	}
+	return container;
+}
+
+template<typename container_t>
+inline uint64_t HashContainerJournal<container_t>::replay(std::istream &journal, const Container &container, bool apply)
+{
+	// Replay every complete record. A torn record at the end was never committed.
+	uint64_t length = sizeof(uint64_t);
+	uint8_t operation;
+	while (journal.read(reinterpret_cast<char *>(&operation), sizeof(operation)))
+	{
+		if (operation == Clear)
+		{
+			if (apply)
+			{
+				container.clear();
+			}
+			length += sizeof(operation);
+			continue;
+		}
+
+		uint64_t hash;
+		sizeType value;
+		if (!journal.read(reinterpret_cast<char *>(&hash), sizeof(hash)) || !journal.read(reinterpret_cast<char *>(&value), sizeof(value)))
+		{
+			break;
+		}
+
+		if (value >= container.nodes() || operation > Allocate)
+		{
+			throw std::runtime_error("HashContainerJournal: Journal is corrupt.");
+		}
+		length += sizeof(operation) + sizeof(hash) + sizeof(value);
+		if (!apply)
+		{
+			continue;
+		}
+
+		if (operation == Insert)
+		{
+			container.insert(static_cast<size_t>(hash), value);
+		}
+		else if (operation == Allocate)
+		{
+			// The free list is part of the snapshot, so replaying chooses the same value again.
+			if (container.insert(static_cast<size_t>(hash)) != value)
+			{
+				throw std::runtime_error("HashContainerJournal: Journal is corrupt.");
+			}
+		}
+		else
+		{
+			container.remove(static_cast<size_t>(hash), value);
+		}
+	}
+
+	return length;
+}
+
+template<typename container_t>
+inline void HashContainerJournal<container_t>::append(Operation operation, size_t hash, sizeType value)
+{
+	// Records consist of the operation followed by hash and value. Clear records have no payload.
+	const uint8_t code = operation;
+	m_pending.insert(m_pending.end(), reinterpret_cast<const char *>(&code), reinterpret_cast<const char *>(&code) + sizeof(code));
+	if (operation != Clear)
+	{
+		const uint64_t fullHash = hash;
+		m_pending.insert(m_pending.end(), reinterpret_cast<const char *>(&fullHash), reinterpret_cast<const char *>(&fullHash) + sizeof(fullHash));
+		m_pending.insert(m_pending.end(), reinterpret_cast<const char *>(&value), reinterpret_cast<const char *>(&value) + sizeof(value));
+	}
+
+	++m_recordsSinceCheckpoint;
+	if (m_recordsSinceCheckpoint >= m_checkpointInterval)
+	{
+		checkpoint();
+	}
+	else if (++m_pendingRecords >= m_groupSize)
+	{
+		commit();
+	}
+}
+
+template<typename container_t>
+inline void HashContainerJournal<container_t>::resetJournal()
+{
+	m_journal.close();
+	m_journal.clear();
+	m_journal.open(m_journalPath, std::ios::binary | std::ios::trunc);
+	m_journal.write(reinterpret_cast<const char *>(&m_generation), sizeof(m_generation));
+	m_journal.flush();
+	if (!m_journal)
+	{
+		throw std::runtime_error("HashContainerJournal: Unable to write journal.");
+	}
+	synchronize(m_journalPath);
+}
+
+template<typename container_t>
+inline void HashContainerJournal<container_t>::synchronize(const std::string &path)
+{
+	// The streams do not expose their descriptors, but fsync writes every cached page of a file regardless of the descriptor.
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		throw std::runtime_error("HashContainerJournal: Unable to synchronize " + path + ".");
+	}
+	const int result = ::fsync(file);
+	::close(file);
+	if (result != 0)
+	{
+		throw std::runtime_error("HashContainerJournal: Unable to synchronize " + path + ".");
+	}
+}
+
+template<typename container_t>
+inline std::string HashContainerJournal<container_t>::directoryOf(const std::string &path)
+{
+	const size_t separator = path.find_last_of('/');
+	if (separator == std::string::npos)
+	{
+		return ".";
+	}
+	return separator == 0 ? "/" : path.substr(0, separator);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <future>
+#include <string>
+
+#include "hashcontainer.h"
+
+//! @short The HashContainerLoader template loads large snapshots with several threads.
+//! The bucket and node arrays of a snapshot written by GenericHashContainer::save are split into
+//! chunks which are read in parallel with positional reads directly into the arrays of the new
+//! container, so the load time is limited by the storage device instead of a single read loop.
+//! @remark This class requires a POSIX system.
+template<typename container_t>
+class HashContainerLoader
+{
+public:
+	using Container = container_t;
+
+	//! @short Construct a loader.
+	//! @param threads : Number of threads issuing reads. Zero selects the number of hardware threads.
+	//! @param chunkSize : Number of bytes a single read transfers at most.
+	explicit HashContainerLoader(size_t threads = 0, size_t chunkSize = 8 << 20);
+
+	//! @short Loads a snapshot from a file.
+	//! @param path : The file containing the snapshot.
+	//! @param offset : Position of the snapshot inside the file, e.g. to skip the generation of a journal checkpoint.
+	//! @throw std::runtime_error when the file can not be read or the snapshot is incompatible.
+	Container load(const std::string &path, uint64_t offset = 0) const;
+
+	//! @short Loads a snapshot from a file in the background.
+	//! @remark The loader must outlive the returned future.
+	std::future<Container> loadAsync(const std::string &path, uint64_t offset = 0) const;
+
+protected:
+	//! @short Reads exactly size bytes at offset, retrying short and interrupted reads.
+	//! @return __True__ when all bytes were read.
+	static bool readAt(int file, char *destination, size_t size, uint64_t offset);
+
+	size_t m_threads;
+	size_t m_chunkSize;
+};
+
+#include "hashcontainerloader.hpp"
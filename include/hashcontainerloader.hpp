@@ -0,0 +1,134 @@
+#include <atomic>
+#include <cerrno>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+template<typename container_t>
+HashContainerLoader<container_t>::HashContainerLoader(size_t threads, size_t chunkSize)
+	: m_threads(threads != 0 ? threads : std::max<size_t>(std::thread::hardware_concurrency(), 1))
+	, m_chunkSize(std::max<size_t>(chunkSize, 4096))
+{
+}
+
+template<typename container_t>
+inline typename HashContainerLoader<container_t>::Container HashContainerLoader<container_t>::load(const std::string &path, uint64_t offset) const
+{
+	// Closes the file on every path out of this function.
+	struct File
+	{
+		~File() { if (descriptor >= 0) ::close(descriptor); }
+		int descriptor;
+	} const handle = { ::open(path.c_str(), O_RDONLY) };
+
+	const int file = handle.descriptor;
+	if (file < 0)
+	{
+		throw std::runtime_error("HashContainerLoader: Unable to open snapshot.");
+	}
+
+	typename Container::SnapshotHeader header;
+	if (!readAt(file, reinterpret_cast<char *>(&header), sizeof(header), offset))
+	{
+		throw std::runtime_error("HashContainer: Snapshot is truncated.");
+	}
+
+	Container result = Container::fromSnapshotHeader(header, Container::snapshotMagic);
+
+	// Both arrays are stored back to back, so they can be described as two regions of the file.
+	struct Region
+	{
+		char *destination;
+		size_t size;
+		uint64_t offset;
+	};
+
+	const uint64_t bucketOffset = offset + sizeof(header);
+	const size_t bucketBytes = sizeof(typename Container::Bucket) * result.m_bucketCount;
+	const size_t nodeBytes = sizeof(typename Container::Node) * result.m_nodeCount;
+
+	std::vector<Region> chunks;
+	const Region regions[] = {
+		{ reinterpret_cast<char *>(result.m_bucketList.get()), bucketBytes, bucketOffset },
+		{ reinterpret_cast<char *>(result.m_nodeList.get()), nodeBytes, bucketOffset + bucketBytes }
+	};
+	for (const Region &region : regions)
+	{
+		for (size_t done = 0; done < region.size; done += m_chunkSize)
+		{
+			chunks.push_back({ region.destination + done, std::min(m_chunkSize, region.size - done), region.offset + done });
+		}
+	}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	::posix_fadvise(file, static_cast<off_t>(bucketOffset), static_cast<off_t>(bucketBytes + nodeBytes), POSIX_FADV_SEQUENTIAL);
+#endif
+
+	// Every thread takes the next chunk until all chunks are read or one read failed.
+	std::atomic<size_t> nextChunk(0);
+	std::atomic<bool> failed(false);
+	auto worker = [&]()
+	{
+		size_t chunk;
+		while (!failed && (chunk = nextChunk++) < chunks.size())
+		{
+			if (!readAt(file, chunks[chunk].destination, chunks[chunk].size, chunks[chunk].offset))
+			{
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	const size_t threadCount = std::min(m_threads, chunks.size());
+	for (size_t i = 1; i < threadCount; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+
+	if (failed)
+	{
+		throw std::runtime_error("HashContainer: Snapshot is truncated.");
+	}
+
+	result.rebuildUsedList();
+	result.checkFreeList();
+	result.sortChains();
+	return result;
+}
+
+template<typename container_t>
+inline std::future<typename HashContainerLoader<container_t>::Container> HashContainerLoader<container_t>::loadAsync(const std::string &path, uint64_t offset) const
+{
+	return std::async(std::launch::async, [this, path, offset]() { return load(path, offset); });
+}
+
+template<typename container_t>
+inline bool HashContainerLoader<container_t>::readAt(int file, char *destination, size_t size, uint64_t offset)
+{
+	while (size != 0)
+	{
+		const ssize_t count = ::pread(file, destination, size, static_cast<off_t>(offset));
+		if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (count <= 0)
+		{
+			return false;
+		}
+
+		destination += count;
+		size -= static_cast<size_t>(count);
+		offset += static_cast<uint64_t>(count);
+	}
+
+	return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "hashcontainer.h"
+
+//! @short The HashMap template defines a fixed size map on top of a HashContainer.
+//! Keys and mapped values are stored in two separate arrays that are indexed by the value of
+//! the container entry, so no entry needs an allocation of its own. The values are chosen by the
+//! free list of the container. Because the container only stores a part of the hash, every hit
+//! is verified by comparing the full key.
+//! Use this map instead of the STL when you know the maximum number of entries in advance.
+template<typename Key, typename T, typename Hasher = std::hash<Key>, typename container_t = HashContainer>
+class HashMap
+{
+public:
+	using Container = container_t;
+	using sizeType = typename Container::sizeType;
+
+	//! @short Construct a HashMap with a fixed size.
+	//! @param entries : Maximum number of entries the HashMap can hold.
+	//! @param hasher : The hash function used for the keys.
+	explicit HashMap(size_t entries, const Hasher &hasher = Hasher());
+
+	//! @short Construct a copy of HashMap instance.
+	HashMap(const HashMap &other);
+
+	//! @short Construct a HashMap invalidating the other instance.
+	HashMap(HashMap &&other);
+
+	//! @short Assigns this instance with another HashMap.
+	HashMap& operator=(HashMap other);
+
+	//! @short Destroys all entries.
+	~HashMap();
+
+	//! @short Swaps this instance with another.
+	void swap(HashMap &other);
+
+	//! @short Searches for a key.
+	//! @return __Pointer to the mapped value__ when the key is found.
+	//! @return __nullptr__ when the key wasn't found.
+	T *find(const Key &key);
+
+	//! @short Searches for a key.
+	//! @return __Pointer to the mapped value__ when the key is found.
+	//! @return __nullptr__ when the key wasn't found.
+	const T *find(const Key &key) const;
+
+	//! @short Inserts a new entry when the key is not found. The mapped value is constructed from args.
+	//! @return __Pointer to the mapped value__ and __true__ when the entry was inserted.
+	//! @return __Pointer to the mapped value__ and __false__ when the key already existed.
+	//! @throw std::runtime_error when the HashMap is full.
+	template<class... Args>
+	std::pair<T *, bool> emplace(const Key &key, Args &&... args);
+
+	//! @short Removes the entry of a key.
+	//! @return __True__ when an entry was removed.
+	bool erase(const Key &key);
+
+	//! @short Removes all entries but does not change its size.
+	void clear();
+
+	//! @short Returns the number of entries.
+	size_t size() const;
+
+	//! @short Returns the maximum number of entries.
+	size_t capacity() const;
+
+protected:
+	template<class U>
+	using Storage = typename std::aligned_storage<sizeof(U), alignof(U)>::type;
+
+	//! @short Returns the slot of a key or sizeLimits::max() when the key is not found.
+	sizeType findSlot(size_t hash, const Key &key) const;
+
+	//! @short Destroys the key and the mapped value of a slot.
+	void destroySlot(sizeType slot);
+
+	const Key &key(sizeType slot) const { return reinterpret_cast<const Key &>(m_keys[slot]); }
+	T &value(sizeType slot) { return reinterpret_cast<T &>(m_values[slot]); }
+	const T &value(sizeType slot) const { return reinterpret_cast<const T &>(m_values[slot]); }
+
+	Container m_container;
+	Hasher m_hasher;
+	size_t m_size;
+
+	std::unique_ptr<Storage<Key>[]> m_keys;
+	std::unique_ptr<Storage<T>[]> m_values;
+};
+
+#include "hashmap.hpp"
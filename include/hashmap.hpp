@@ -0,0 +1,216 @@
+template<typename Key, typename T, typename Hasher, typename container_t>
+HashMap<Key, T, Hasher, container_t>::HashMap(size_t entries, const Hasher &hasher)
+	: m_container(entries)
+	, m_hasher(hasher)
+	, m_size(0)
+	, m_keys(std::make_unique<Storage<Key>[]>(entries))
+	, m_values(std::make_unique<Storage<T>[]>(entries))
+{
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+HashMap<Key, T, Hasher, container_t>::HashMap(const HashMap &other)
+	: m_container(other.m_container)
+	, m_hasher(other.m_hasher)
+	, m_size(0)
+	, m_keys(std::make_unique<Storage<Key>[]>(other.capacity()))
+	, m_values(std::make_unique<Storage<T>[]>(other.capacity()))
+{
+	if (other.m_size == 0)
+	{
+		return;
+	}
+
+	// The container is copied as a whole, so every entry keeps its slot.
+	auto it = other.m_container.begin();
+	try
+	{
+		for (; it; ++it)
+		{
+			new (&m_keys[*it]) Key(other.key(*it));
+			try
+			{
+				new (&m_values[*it]) T(other.value(*it));
+			}
+			catch (...)
+			{
+				key(*it).~Key();
+				throw;
+			}
+		}
+	}
+	catch (...)
+	{
+		for (auto done = other.m_container.begin(); done != it; ++done)
+		{
+			destroySlot(*done);
+		}
+		throw;
+	}
+
+	m_size = other.m_size;
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+HashMap<Key, T, Hasher, container_t>::HashMap(HashMap &&other)
+	: m_container(std::move(other.m_container))
+	, m_hasher(std::move(other.m_hasher))
+	, m_size(other.m_size)
+	, m_keys(std::move(other.m_keys))
+	, m_values(std::move(other.m_values))
+{
+	other.m_size = 0;
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+HashMap<Key, T, Hasher, container_t>& HashMap<Key, T, Hasher, container_t>::operator=(HashMap other)
+{
+	swap(other);
+	return *this;
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+HashMap<Key, T, Hasher, container_t>::~HashMap()
+{
+	if (m_size != 0)
+	{
+		clear();
+	}
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline void HashMap<Key, T, Hasher, container_t>::swap(HashMap &other)
+{
+	m_container.swap(other.m_container);
+	std::swap(m_hasher, other.m_hasher);
+	std::swap(m_size, other.m_size);
+
+	std::swap(m_keys, other.m_keys);
+	std::swap(m_values, other.m_values);
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline T *HashMap<Key, T, Hasher, container_t>::find(const Key &key)
+{
+	const sizeType slot = findSlot(m_hasher(key), key);
+	return slot != Container::sizeLimits::max() ? &value(slot) : nullptr;
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline const T *HashMap<Key, T, Hasher, container_t>::find(const Key &key) const
+{
+	const sizeType slot = findSlot(m_hasher(key), key);
+	return slot != Container::sizeLimits::max() ? &value(slot) : nullptr;
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+template<class... Args>
+inline std::pair<T *, bool> HashMap<Key, T, Hasher, container_t>::emplace(const Key &key, Args &&... args)
+{
+	if (capacity() == 0)
+	{
+		throw std::runtime_error("HashMap: Size is too small.");
+	}
+
+	const size_t hash = m_hasher(key);
+	auto result = m_container.findOrInsert(hash, [&](sizeType slot) { return this->key(slot) == key; });
+	const sizeType slot = *result.first;
+	if (!result.second)
+	{
+		if (slot == Container::sizeLimits::max())
+		{
+			throw std::runtime_error("HashMap: Size is too small.");
+		}
+		return std::make_pair(&value(slot), false);
+	}
+
+	try
+	{
+		new (&m_keys[slot]) Key(key);
+		try
+		{
+			new (&m_values[slot]) T(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			this->key(slot).~Key();
+			throw;
+		}
+	}
+	catch (...)
+	{
+		m_container.remove(hash, slot);
+		throw;
+	}
+
+	++m_size;
+	return std::make_pair(&value(slot), true);
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline bool HashMap<Key, T, Hasher, container_t>::erase(const Key &key)
+{
+	if (m_size == 0)
+	{
+		return false;
+	}
+
+	// The Iterator knows the node linking to the slot, so the chain is only walked once.
+	const auto it = m_container.findIf(m_hasher(key), [&](sizeType slot) { return this->key(slot) == key; });
+	if (!it)
+	{
+		return false;
+	}
+
+	const sizeType slot = *it;
+	m_container.erase(it);
+	destroySlot(slot);
+	--m_size;
+	return true;
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline void HashMap<Key, T, Hasher, container_t>::clear()
+{
+	if (m_size != 0)
+	{
+		for (auto it = m_container.begin(); it; ++it)
+		{
+			destroySlot(*it);
+		}
+	}
+
+	m_container.clear();
+	m_size = 0;
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline size_t HashMap<Key, T, Hasher, container_t>::size() const
+{
+	return m_size;
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline size_t HashMap<Key, T, Hasher, container_t>::capacity() const
+{
+	return m_container.nodes();
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline typename HashMap<Key, T, Hasher, container_t>::sizeType HashMap<Key, T, Hasher, container_t>::findSlot(size_t hash, const Key &key) const
+{
+	if (m_size == 0)
+	{
+		return Container::sizeLimits::max();
+	}
+
+	// The container only compares a part of the hash, so the keys need to be compared as well.
+	return *m_container.findIf(hash, [&](sizeType slot) { return this->key(slot) == key; });
+}
+
+template<typename Key, typename T, typename Hasher, typename container_t>
+inline void HashMap<Key, T, Hasher, container_t>::destroySlot(sizeType slot)
+{
+	key(slot).~Key();
+	value(slot).~T();
+}
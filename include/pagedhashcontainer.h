@@ -0,0 +1,154 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hashcontainer.h"
+
+//! @short The PagedHashContainer template defines a HashContainer that lives in a file.
+//! The file uses the snapshot format of GenericHashContainer::save, so snapshots can be opened
+//! without loading them and a PagedHashContainer can be loaded into memory again later.
+//! Buckets and nodes are split into fixed size pages and only a bounded number of pages is held in memory.
+//! Missing pages are read on demand and the least recently referenced pages are evicted with the CLOCK algorithm.
+//! Use this container instead of a HashContainer when the index does not fit into memory.
+template<typename sizeType_t, typename hashType_t>
+class GenericPagedHashContainer
+{
+public:
+	using sizeType = sizeType_t;
+	using hashType = hashType_t;
+	using Container = GenericHashContainer<sizeType, hashType>;
+	using Bucket = typename Container::Bucket;
+	using Node = typename Container::Node;
+	using sizeLimits = typename Container::sizeLimits;
+
+	//! @short Number of bytes of a single page.
+	static const size_t pageSize = 4096;
+
+	//! @short Construct an empty PagedHashContainer in a new file.
+	//! @param path : The file to create. An existing file is overwritten.
+	//! @param entries : Maximum number of entries the PagedHashContainer can hold.
+	//! @param poolPages : Maximum number of pages held in memory.
+	GenericPagedHashContainer(const std::string &path, size_t entries, size_t poolPages);
+
+	//! @short Construct a PagedHashContainer from an existing snapshot file.
+	//! @param path : The file containing the snapshot.
+	//! @param poolPages : Maximum number of pages held in memory.
+	//! @throw std::runtime_error when the file can not be opened or the snapshot is incompatible.
+	//! Snapshots of containers with GenericHashContainer::TwoChoices are incompatible.
+	//! Snapshots of containers that used GenericHashContainer::insert(hash) are incompatible as well,
+	//! since modifying them would leave values on the free list that are in use.
+	GenericPagedHashContainer(const std::string &path, size_t poolPages);
+
+	//! @short Writes all modified pages back to the file.
+	~GenericPagedHashContainer();
+
+	GenericPagedHashContainer(const GenericPagedHashContainer &other) = delete;
+	GenericPagedHashContainer& operator=(const GenericPagedHashContainer &other) = delete;
+
+	//! @short This Iterator class is used to access All Element with the same hash.
+	class SearchIterator
+	{
+	public:
+		//! @short Construct an Iterator. Only used inside of the PagedHashContainer.
+		SearchIterator(const GenericPagedHashContainer &ptr, sizeType pos) : m_container(ptr), m_position(pos) {}
+
+		//! @short Accessor for the value this Iterator points to.
+		sizeType operator*() const { return m_position; }
+
+		//! @short Operator to check validness of the Iterator.
+		operator bool() const { return m_position != sizeLimits::max(); }
+
+		//! @short Pre-increment to access the next value with the same hash as the current.
+		SearchIterator& operator++()
+		{
+			m_position = m_container.findNext(m_position);
+			return *this;
+		}
+
+	protected:
+		const GenericPagedHashContainer &m_container;
+		sizeType m_position;
+	};
+
+	//! @short Inserts a hash value pair into this container. See GenericHashContainer::insert.
+	//! @remark There is no integrated free list, which is why snapshots that use one can not be opened.
+	void insert(size_t hash, sizeType value) const;
+
+	//! @short Removes a hash value pair from this container. See GenericHashContainer::remove.
+	void remove(size_t hash, sizeType value) const;
+
+	//! @short Removes the content but does not change its size.
+	void clear() const;
+
+	//! @short Searches for a specific hash and returns an Iterator.
+	SearchIterator find(size_t hash) const;
+
+	//! @short Writes all modified pages back to the file.
+	void flush() const;
+
+	//! @short Returns the number of nodes of this instance.
+	sizeType nodes() const;
+
+	//! @short Returns the number of buckets of this instance.
+	sizeType buckets() const;
+
+	//! @short Returns the internal hash of an entry.
+	hashType hash(sizeType index) const;
+
+protected:
+	//! @short A Frame holds one page of the buffer pool.
+	struct Frame
+	{
+		uint64_t page;
+		bool referenced;
+		bool dirty;
+		std::unique_ptr<char[]> data;
+	};
+
+	//! @short Internal find used by SearchIterator.
+	sizeType findNext(sizeType current) const;
+
+	//! @short Internal find to retrieve the next hash.
+	sizeType findNext(hashType hash, sizeType current) const;
+
+	Bucket readBucket(sizeType index) const;
+	void writeBucket(sizeType index, Bucket bucket) const;
+	Node readNode(sizeType index) const;
+	void writeNode(sizeType index, Node node) const;
+
+	//! @short Returns the address of an element, loading its page when necessary.
+	//! The address is only valid until the next page is accessed.
+	template<class T>
+	T *element(uint64_t array, sizeType index, bool write) const;
+
+	//! @short Returns the frame holding a page, evicting another page when the pool is full.
+	Frame &fetch(uint64_t page) const;
+
+	//! @short Writes a modified frame back to the file.
+	void writeBack(const Frame &frame) const;
+
+	//! @short Returns the file offset and the size of a page. Pages of one array never contain elements of the other.
+	void pageExtent(uint64_t page, uint64_t &offset, size_t &size) const;
+
+	static const uint64_t bucketArray = 0;
+	static const uint64_t nodeArray = 1;
+	//! @short Marks a frame that holds no page.
+	static const uint64_t invalidPage = std::numeric_limits<uint64_t>::max();
+
+	sizeType m_bucketCount;
+	sizeType m_nodeCount;
+
+	mutable std::fstream m_file;
+	size_t m_poolPages;
+	mutable std::vector<Frame> m_frames;
+	mutable std::unordered_map<uint64_t, size_t> m_pageTable;
+	mutable size_t m_clockHand;
+};
+
+using PagedHashContainer = GenericPagedHashContainer<uint32_t, uint32_t>;
+using SparsePagedHashContainer = GenericPagedHashContainer<uint32_t, uint16_t>;
+
+#include "pagedhashcontainer.hpp"
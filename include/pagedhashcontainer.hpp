@@ -0,0 +1,367 @@
+template<typename sizeType, typename hashType>
+const size_t GenericPagedHashContainer<sizeType, hashType>::pageSize;
+
+template<typename sizeType, typename hashType>
+const uint64_t GenericPagedHashContainer<sizeType, hashType>::bucketArray;
+
+template<typename sizeType, typename hashType>
+const uint64_t GenericPagedHashContainer<sizeType, hashType>::nodeArray;
+
+template<typename sizeType, typename hashType>
+const uint64_t GenericPagedHashContainer<sizeType, hashType>::invalidPage;
+
+template<typename sizeType, typename hashType>
+GenericPagedHashContainer<sizeType, hashType>::GenericPagedHashContainer(const std::string &path, size_t entries, size_t poolPages)
+	: m_bucketCount(Container::computeBucketCount(entries))
+	, m_nodeCount(static_cast<sizeType>(entries))
+	, m_file(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc)
+	, m_poolPages(std::max<size_t>(poolPages, 1))
+	, m_clockHand(0)
+{
+	typename Container::SnapshotHeader header;
+	header.magic = Container::snapshotMagic;
+	header.version = Container::snapshotVersion;
+	header.sizeTypeBytes = sizeof(sizeType);
+	header.hashTypeBytes = sizeof(hashType);
+	header.flags = 0;
+	header.reserved = 0;
+	header.bucketCount = m_bucketCount;
+	header.nodeCount = m_nodeCount;
+	header.freeHead = sizeLimits::max();
+	header.allocatedCount = 0;
+	m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	// Both arrays are initialized with an invalid value just like GenericHashContainer::clear does.
+	const std::vector<char> invalid(pageSize, static_cast<char>(std::numeric_limits<unsigned char>::max()));
+	uint64_t remaining = sizeof(Bucket) * static_cast<uint64_t>(m_bucketCount) + sizeof(Node) * static_cast<uint64_t>(m_nodeCount);
+	while (remaining != 0)
+	{
+		const size_t size = static_cast<size_t>(std::min<uint64_t>(remaining, pageSize));
+		m_file.write(invalid.data(), size);
+		remaining -= size;
+	}
+
+	m_file.flush();
+	if (!m_file)
+	{
+		throw std::runtime_error("PagedHashContainer: Unable to create file.");
+	}
+}
+
+template<typename sizeType, typename hashType>
+GenericPagedHashContainer<sizeType, hashType>::GenericPagedHashContainer(const std::string &path, size_t poolPages)
+	: m_bucketCount(0)
+	, m_nodeCount(0)
+	, m_file(path, std::ios::in | std::ios::out | std::ios::binary)
+	, m_poolPages(std::max<size_t>(poolPages, 1))
+	, m_clockHand(0)
+{
+	typename Container::SnapshotHeader header;
+	if (!m_file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+	{
+		throw std::runtime_error("PagedHashContainer: Unable to open file.");
+	}
+
+	if (header.magic != Container::snapshotMagic || header.version != Container::snapshotVersion
+		|| header.sizeTypeBytes != sizeof(sizeType) || header.hashTypeBytes != sizeof(hashType) || header.flags != 0
+		|| header.nodeCount >= sizeLimits::max() || header.bucketCount > sizeLimits::max() || (header.bucketCount == 0 && header.nodeCount != 0)
+		|| header.allocatedCount != 0 || header.freeHead != sizeLimits::max())
+	{
+		throw std::runtime_error("HashContainer: Snapshot is incompatible.");
+	}
+
+	m_bucketCount = static_cast<sizeType>(header.bucketCount);
+	m_nodeCount = static_cast<sizeType>(header.nodeCount);
+
+	// Reject truncated files up front, a page that can not be read later leaves an operation half done.
+	const uint64_t fileBytes = sizeof(header) + sizeof(Bucket) * static_cast<uint64_t>(m_bucketCount) + sizeof(Node) * static_cast<uint64_t>(m_nodeCount);
+	if (!m_file.seekg(0, std::ios::end) || static_cast<uint64_t>(m_file.tellg()) < fileBytes)
+	{
+		throw std::runtime_error("PagedHashContainer: File is truncated.");
+	}
+}
+
+template<typename sizeType, typename hashType>
+GenericPagedHashContainer<sizeType, hashType>::~GenericPagedHashContainer()
+{
+	try
+	{
+		flush();
+	}
+	catch (...)
+	{
+		// Destructors must not throw. Modified pages that can not be written are lost.
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericPagedHashContainer<sizeType, hashType>::insert(size_t hash, sizeType value) const
+{
+	assert(readNode(value).next == sizeLimits::max());
+	assert(readNode(value).hash == Container::hashLimits::max());
+
+	// The low part refers to the bucket and the high part
+	// is used to distinct different entries in a single bucket.
+	const sizeType index = Container::low(hash) % m_bucketCount;
+	Bucket bucket = readBucket(index);
+
+	// Let the bucket point to the new inserted element.
+	writeNode(value, { Container::high(hash), bucket.first });
+	bucket.first = value;
+	writeBucket(index, bucket);
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericPagedHashContainer<sizeType, hashType>::remove(size_t hash, sizeType value) const
+{
+	// Do not remove anything when the hashes do not match.
+	const Node node = readNode(value);
+	if (node.hash != Container::high(hash))
+	{
+		return;
+	}
+
+	// Just remove the entry when it is the first entry.
+	const sizeType index = Container::low(hash) % m_bucketCount;
+	sizeType current = readBucket(index).first;
+	if (current == value)
+	{
+		writeBucket(index, { node.next });
+	}
+	else
+	{
+		// When it is not the first entry we need to find the element
+		// that points to the removed element to adjust its next pointer.
+		while (current != sizeLimits::max())
+		{
+			Node previous = readNode(current);
+			if (previous.next == value)
+			{
+				previous.next = node.next;
+				writeNode(current, previous);
+				break;
+			}
+
+			current = previous.next;
+		}
+	}
+
+#ifndef NDEBUG
+	// It is necessary to overwrite the memory in debug mode with an
+	// invalid value to get the assertion detect invalid operations.
+	writeNode(value, { Container::hashLimits::max(), sizeLimits::max() });
+#endif
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericPagedHashContainer<sizeType, hashType>::clear() const
+{
+	// Every page is overwritten completely, so it does not matter what it contained before.
+	const uint64_t arrays[] = { bucketArray, nodeArray };
+	const sizeType counts[] = { m_bucketCount, m_nodeCount };
+	const size_t sizes[] = { sizeof(Bucket), sizeof(Node) };
+
+#ifdef NDEBUG
+	// Nodes are only reset in debug mode, see GenericHashContainer::clear.
+	const size_t arrayCount = 1;
+#else
+	const size_t arrayCount = 2;
+#endif
+
+	for (size_t array = 0; array < arrayCount; ++array)
+	{
+		const uint64_t pages = (sizes[array] * static_cast<uint64_t>(counts[array]) + pageSize - 1) / pageSize;
+		for (uint64_t page = 0; page < pages; ++page)
+		{
+			Frame &frame = fetch((page << 1) | arrays[array]);
+			std::memset(frame.data.get(), std::numeric_limits<unsigned char>::max(), pageSize);
+			frame.dirty = true;
+		}
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericPagedHashContainer<sizeType, hashType>::SearchIterator GenericPagedHashContainer<sizeType, hashType>::find(size_t hash) const
+{
+	return SearchIterator(*this, findNext(Container::high(hash), readBucket(Container::low(hash) % m_bucketCount).first));
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericPagedHashContainer<sizeType, hashType>::flush() const
+{
+	for (Frame &frame : m_frames)
+	{
+		if (frame.dirty)
+		{
+			writeBack(frame);
+			frame.dirty = false;
+		}
+	}
+
+	m_file.flush();
+	if (!m_file)
+	{
+		throw std::runtime_error("PagedHashContainer: Unable to write file.");
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericPagedHashContainer<sizeType, hashType>::nodes() const
+{
+	return m_nodeCount;
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericPagedHashContainer<sizeType, hashType>::buckets() const
+{
+	return m_bucketCount;
+}
+
+template<typename sizeType, typename hashType>
+inline hashType GenericPagedHashContainer<sizeType, hashType>::hash(sizeType index) const
+{
+	return readNode(index).hash;
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericPagedHashContainer<sizeType, hashType>::findNext(sizeType current) const
+{
+	const Node node = readNode(current);
+	return findNext(node.hash, node.next);
+}
+
+template<typename sizeType, typename hashType>
+inline sizeType GenericPagedHashContainer<sizeType, hashType>::findNext(hashType hash, sizeType current) const
+{
+	while (current != sizeLimits::max())
+	{
+		const Node node = readNode(current);
+		if (node.hash == hash)
+			return current;
+		current = node.next;
+	}
+
+	return sizeLimits::max();
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericPagedHashContainer<sizeType, hashType>::Bucket GenericPagedHashContainer<sizeType, hashType>::readBucket(sizeType index) const
+{
+	return *element<Bucket>(bucketArray, index, false);
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericPagedHashContainer<sizeType, hashType>::writeBucket(sizeType index, Bucket bucket) const
+{
+	*element<Bucket>(bucketArray, index, true) = bucket;
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericPagedHashContainer<sizeType, hashType>::Node GenericPagedHashContainer<sizeType, hashType>::readNode(sizeType index) const
+{
+	return *element<Node>(nodeArray, index, false);
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericPagedHashContainer<sizeType, hashType>::writeNode(sizeType index, Node node) const
+{
+	*element<Node>(nodeArray, index, true) = node;
+}
+
+template<typename sizeType, typename hashType>
+template<class T>
+inline T *GenericPagedHashContainer<sizeType, hashType>::element(uint64_t array, sizeType index, bool write) const
+{
+	// Buckets and nodes have a size that is a power of two, so no element crosses a page boundary.
+	static_assert(pageSize % sizeof(T) == 0, "Page size must be a multiple of the element size.");
+	const size_t perPage = pageSize / sizeof(T);
+
+	Frame &frame = fetch((static_cast<uint64_t>(index / perPage) << 1) | array);
+	frame.referenced = true;
+	frame.dirty |= write;
+	return reinterpret_cast<T *>(frame.data.get()) + index % perPage;
+}
+
+template<typename sizeType, typename hashType>
+inline typename GenericPagedHashContainer<sizeType, hashType>::Frame &GenericPagedHashContainer<sizeType, hashType>::fetch(uint64_t page) const
+{
+	auto found = m_pageTable.find(page);
+	if (found != m_pageTable.end())
+	{
+		return m_frames[found->second];
+	}
+
+	size_t victim;
+	if (m_frames.size() < m_poolPages)
+	{
+		victim = m_frames.size();
+		m_frames.push_back({ invalidPage, false, false, std::make_unique<char[]>(pageSize) });
+	}
+	else
+	{
+		// Advance the clock hand and give every referenced page a second chance.
+		while (m_frames[m_clockHand].referenced)
+		{
+			m_frames[m_clockHand].referenced = false;
+			m_clockHand = (m_clockHand + 1) % m_frames.size();
+		}
+
+		victim = m_clockHand;
+		m_clockHand = (m_clockHand + 1) % m_frames.size();
+
+		if (m_frames[victim].dirty)
+		{
+			writeBack(m_frames[victim]);
+			m_frames[victim].dirty = false;
+		}
+		m_pageTable.erase(m_frames[victim].page);
+	}
+
+	// The frame is free until the read succeeds, so a failed read leaves nothing behind that flush would write.
+	Frame &frame = m_frames[victim];
+	frame.page = invalidPage;
+	uint64_t offset;
+	size_t size;
+	pageExtent(page, offset, size);
+
+	m_file.seekg(static_cast<std::streamoff>(offset));
+	if (!m_file.read(frame.data.get(), size))
+	{
+		m_file.clear();
+		throw std::runtime_error("PagedHashContainer: Unable to read file.");
+	}
+
+	frame.page = page;
+	frame.referenced = true;
+	m_pageTable[page] = victim;
+	return frame;
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericPagedHashContainer<sizeType, hashType>::writeBack(const Frame &frame) const
+{
+	uint64_t offset;
+	size_t size;
+	pageExtent(frame.page, offset, size);
+
+	m_file.seekp(static_cast<std::streamoff>(offset));
+	if (!m_file.write(frame.data.get(), size))
+	{
+		m_file.clear();
+		throw std::runtime_error("PagedHashContainer: Unable to write file.");
+	}
+}
+
+template<typename sizeType, typename hashType>
+inline void GenericPagedHashContainer<sizeType, hashType>::pageExtent(uint64_t page, uint64_t &offset, size_t &size) const
+{
+	const uint64_t bucketBytes = sizeof(Bucket) * static_cast<uint64_t>(m_bucketCount);
+	const uint64_t nodeBytes = sizeof(Node) * static_cast<uint64_t>(m_nodeCount);
+
+	const bool nodes = (page & 1) == nodeArray;
+	const uint64_t begin = (page >> 1) * pageSize;
+	const uint64_t arrayBytes = nodes ? nodeBytes : bucketBytes;
+
+	offset = sizeof(typename Container::SnapshotHeader) + (nodes ? bucketBytes : 0) + begin;
+	size = static_cast<size_t>(std::min<uint64_t>(pageSize, arrayBytes - begin));
+}
@@ -2,6 +2,11 @@
 
 #include <hashcontainer.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+
 const std::vector<size_t> sizes = {1, 4, 7, 12, 41, 99, 120};
 
 template<typename container_t>
@@ -135,7 +140,7 @@ TYPED_TEST(HashContainer_test, insert_n_elements_in_1_buckets)
 		auto it = container.find(0);
 		for (uint32_t i = 0; i < size; ++i)
 		{
-			ASSERT_EQ(*it, size - i - 1);
+			ASSERT_EQ(*it, i);
 			++it;
 		}
 		ASSERT_FALSE(it);
@@ -247,3 +252,1227 @@ TYPED_TEST(HashContainer_test, iterator_operator_bool)
 
 	ASSERT_FALSE(container.find(1));
 }
+
+TYPED_TEST(HashContainer_test, save_and_load_snapshot)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i / 2, i);
+		}
+
+		std::stringstream stream;
+		container.save(stream);
+		TypeParam loaded = TypeParam::load(stream);
+
+		ASSERT_EQ(loaded.nodes(), container.nodes());
+		ASSERT_EQ(loaded.buckets(), container.buckets());
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			auto it = loaded.find(i / 2);
+			auto expected = container.find(i / 2);
+			for (; expected; ++expected, ++it)
+			{
+				ASSERT_EQ(*it, *expected);
+			}
+			ASSERT_FALSE(it);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, load_truncated_snapshot_throw)
+{
+	TypeParam container(12);
+	std::stringstream stream;
+	container.save(stream);
+
+	std::string data = stream.str();
+	std::stringstream truncated(data.substr(0, data.size() - 1));
+	EXPECT_THROW(TypeParam::load(truncated), std::runtime_error);
+
+	std::stringstream empty;
+	EXPECT_THROW(TypeParam::load(empty), std::runtime_error);
+}
+
+TYPED_TEST(HashContainer_test, save_and_load_compressed_snapshot)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; i += 3)
+		{
+			container.insert(i / 2, i);
+		}
+
+		std::stringstream raw;
+		container.save(raw);
+		std::stringstream compressed;
+		container.saveCompressed(compressed);
+		if (size > 12)
+		{
+			// Small containers are dominated by the header.
+			ASSERT_LT(compressed.str().size(), raw.str().size());
+		}
+
+		TypeParam loaded = TypeParam::loadCompressed(compressed);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			auto it = loaded.find(i / 2);
+			auto expected = container.find(i / 2);
+			for (; expected; ++expected, ++it)
+			{
+				ASSERT_EQ(*it, *expected);
+			}
+			ASSERT_FALSE(it);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, load_corrupt_compressed_snapshot_throw)
+{
+	TypeParam container(12);
+	container.insert(0, 0);
+
+	std::stringstream stream;
+	container.saveCompressed(stream);
+	std::string data = stream.str();
+
+	std::stringstream truncated(data.substr(0, data.size() - 1));
+	EXPECT_THROW(TypeParam::loadCompressed(truncated), std::runtime_error);
+
+	std::stringstream raw;
+	container.save(raw);
+	EXPECT_THROW(TypeParam::loadCompressed(raw), std::runtime_error);
+}
+
+TYPED_TEST(HashContainer_test, load_corrupt_free_list_throw)
+{
+	using sizeType = typename TypeParam::sizeType;
+	TypeParam container(12);
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		container.insert(i);
+	}
+	container.remove(1, 1);
+	container.remove(2, 2);
+
+	std::stringstream stream;
+	container.save(stream);
+	const std::string data = stream.str();
+
+	// The free list is 2 -> 1, so patching the successor of node 2 corrupts it.
+	auto patched = [&data, &container](sizeType next)
+	{
+		std::string result = data;
+		const size_t offset = sizeof(typename TypeParam::SnapshotHeader) + sizeof(typename TypeParam::Bucket) * container.buckets()
+			+ sizeof(typename TypeParam::Node) * 2 + offsetof(typename TypeParam::Node, next);
+		std::memcpy(&result[offset], &next, sizeof(next));
+		return result;
+	};
+
+	std::stringstream valid(patched(1));
+	TypeParam loaded = TypeParam::load(valid);
+	ASSERT_EQ(loaded.insert(5), 2);
+	ASSERT_EQ(loaded.insert(6), 1);
+	ASSERT_EQ(loaded.insert(7), 4);
+
+	for (sizeType next : { sizeType(100), sizeType(0), sizeType(2), sizeType(5) })
+	{
+		std::stringstream corrupt(patched(next));
+		EXPECT_THROW(TypeParam::load(corrupt), std::runtime_error);
+	}
+}
+
+TYPED_TEST(HashContainer_test, insert_chooses_unused_values)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			ASSERT_EQ(container.insert(i), i);
+		}
+		ASSERT_EQ(container.insert(size), TypeParam::sizeLimits::max());
+
+		for (uint32_t i = 0; i < size; i += 2)
+		{
+			container.remove(i, i);
+		}
+
+		for (uint32_t i = 0; i < size; i += 2)
+		{
+			const auto value = container.insert(i + size);
+			ASSERT_EQ(value % 2, 0);
+			ASSERT_EQ(*container.find(i + size), value);
+		}
+		ASSERT_EQ(container.insert(size), TypeParam::sizeLimits::max());
+
+		for (uint32_t i = 1; i < size; i += 2)
+		{
+			ASSERT_EQ(*container.find(i), i);
+		}
+
+		container.clear();
+		ASSERT_EQ(container.insert(0), 0);
+	}
+}
+
+TYPED_TEST(HashContainer_test, snapshot_keeps_free_list)
+{
+	TypeParam container(12);
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		container.insert(i);
+	}
+	container.remove(3, 3);
+
+	std::stringstream stream;
+	container.saveCompressed(stream);
+	TypeParam loaded = TypeParam::loadCompressed(stream);
+	ASSERT_EQ(loaded.insert(20), 3);
+	ASSERT_EQ(loaded.insert(21), 6);
+}
+
+TYPED_TEST(HashContainer_test, find_if_skips_rejected_values)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(0, i);
+		}
+
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			auto it = container.findIf(0, [i](typename TypeParam::sizeType value) { return value == i; });
+			ASSERT_TRUE(it);
+			ASSERT_EQ(*it, i);
+		}
+
+		ASSERT_FALSE(container.findIf(0, [](typename TypeParam::sizeType) { return false; }));
+		ASSERT_FALSE(container.findIf(1, [](typename TypeParam::sizeType) { return true; }));
+	}
+}
+
+TYPED_TEST(HashContainer_test, find_or_insert_once)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		std::vector<uint32_t> keys(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			keys[i] = i / 2;
+			auto result = container.findOrInsert(0, i, [&](typename TypeParam::sizeType value) { return keys[value] == i / 2; });
+			ASSERT_EQ(result.second, i % 2 == 0);
+			ASSERT_EQ(*result.first, i - i % 2);
+			if (!result.second)
+			{
+				keys[i] = -1;
+			}
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, find_or_insert_chooses_unused_values)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			auto result = container.findOrInsert(i, [](typename TypeParam::sizeType) { return true; });
+			ASSERT_TRUE(result.second);
+			ASSERT_EQ(*result.first, i);
+
+			auto existing = container.findOrInsert(i, [](typename TypeParam::sizeType) { return true; });
+			ASSERT_FALSE(existing.second);
+			ASSERT_EQ(*existing.first, i);
+		}
+
+		auto full = container.findOrInsert(size, [](typename TypeParam::sizeType) { return false; });
+		ASSERT_FALSE(full.second);
+		ASSERT_FALSE(full.first);
+	}
+}
+
+TYPED_TEST(HashContainer_test, find_or_insert_into_long_chains)
+{
+	for (auto size : sizes)
+	{
+		for (auto choice : { TypeParam::SingleChoice, TypeParam::TwoChoices })
+		{
+			// Few distinct hashes put many nodes into every chain, so they are indexed while findOrInsert links the nodes.
+			auto hashOf = [](uint32_t i) { return static_cast<size_t>(i * 7 % 61) << (sizeof(size_t) * 8 - 8); };
+			TypeParam container(size, choice);
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				auto result = container.findOrInsert(hashOf(i), i, [i](typename TypeParam::sizeType value) { return value == i; });
+				ASSERT_TRUE(result.second);
+				ASSERT_EQ(*result.first, i);
+
+				// The returned Iterator knows the node linking to the inserted one.
+				if (i % 5 == 0)
+				{
+					container.erase(result.first);
+				}
+			}
+
+			for (uint32_t i = 0; i < size; i += 5)
+			{
+				ASSERT_FALSE(container.findIf(hashOf(i), [i](typename TypeParam::sizeType value) { return value == i; }));
+				ASSERT_TRUE(container.findOrInsert(hashOf(i), i, [i](typename TypeParam::sizeType value) { return value == i; }).second);
+			}
+
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				size_t count = 0;
+				for (auto it = container.find(hashOf(i)); it; ++it)
+				{
+					count += container.hash(*it) == container.hash(i);
+				}
+				ASSERT_EQ(count, (size - i % 61 + 60) / 61);
+			}
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, erase_while_iterating)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i % 3, i);
+		}
+
+		for (uint32_t hash = 0; hash < 3; ++hash)
+		{
+			for (auto it = container.find(hash); it;)
+			{
+				if (*it % 2 == 0)
+				{
+					it = container.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+
+		for (uint32_t hash = 0; hash < 3; ++hash)
+		{
+			uint32_t count = 0;
+			for (auto it = container.find(hash); it; ++it)
+			{
+				ASSERT_EQ(*it % 2, 1);
+				ASSERT_EQ(*it % 3, hash);
+				++count;
+			}
+
+			uint32_t expected = 0;
+			for (uint32_t i = hash; i < size; i += 3)
+			{
+				expected += i % 2;
+			}
+			ASSERT_EQ(count, expected);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, erase_returns_value_to_free_list)
+{
+	TypeParam container(4);
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		container.insert(0);
+	}
+
+	auto it = container.findIf(0, [](typename TypeParam::sizeType value) { return value == 2; });
+	it = container.erase(it);
+	ASSERT_EQ(*it, 3);
+	ASSERT_EQ(container.insert(0), 2);
+}
+
+TYPED_TEST(HashContainer_test, remove_and_retain_if)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i / 3, i);
+		}
+
+		const size_t removed = container.removeIf([](typename TypeParam::sizeType value) { return value % 2 == 0; });
+		ASSERT_EQ(removed, (size + 1) / 2);
+
+		const size_t retained = container.retainIf([](typename TypeParam::sizeType value) { return value % 4 == 1; });
+		ASSERT_EQ(retained, size / 4);
+
+		uint32_t count = 0;
+		for (auto it = container.begin(); it; ++it)
+		{
+			ASSERT_EQ(*it % 4, 1);
+			++count;
+		}
+		ASSERT_EQ(count, (size + 2) / 4);
+	}
+}
+
+TYPED_TEST(HashContainer_test, remove_batch)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i / 2, i);
+		}
+
+		std::vector<std::pair<size_t, typename TypeParam::sizeType>> batch;
+		for (uint32_t i = size; i-- > 0;)
+		{
+			if (i % 3 == 0)
+			{
+				batch.emplace_back(i / 2, static_cast<typename TypeParam::sizeType>(i));
+			}
+		}
+		// Wrong hashes are ignored.
+		batch.emplace_back(size, 1);
+
+		ASSERT_EQ(container.removeBatch(batch.begin(), batch.end()), (size + 2) / 3);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			bool found = false;
+			for (auto it = container.find(i / 2); it; ++it)
+			{
+				found |= *it == i;
+			}
+			ASSERT_EQ(found, i % 3 != 0);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, compact)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			ASSERT_EQ(container.insert(i), i);
+		}
+		for (uint32_t i = 0; i < size; i += 2)
+		{
+			container.remove(i, i);
+		}
+
+		const auto mapping = container.compact();
+		ASSERT_EQ(mapping.size(), size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			if (i % 2 == 0)
+			{
+				ASSERT_EQ(mapping[i], TypeParam::sizeLimits::max());
+				ASSERT_FALSE(container.find(i));
+			}
+			else
+			{
+				ASSERT_EQ(mapping[i], i / 2);
+				ASSERT_EQ(*container.find(i), i / 2);
+			}
+		}
+
+		// Values are handed out behind the compacted range.
+		for (uint32_t i = size / 2; i < size; ++i)
+		{
+			ASSERT_EQ(container.insert(size + i), i);
+		}
+		ASSERT_EQ(container.insert(2 * size), TypeParam::sizeLimits::max());
+	}
+}
+
+TYPED_TEST(HashContainer_test, reorder_for_locality)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i * 7919, size - 1 - i);
+		}
+		container.remove(0, size - 1);
+
+		const auto mapping = container.reorderForLocality();
+		ASSERT_EQ(mapping[size - 1], TypeParam::sizeLimits::max());
+
+		// Iterating is a sequential scan now.
+		typename TypeParam::sizeType expected = 0;
+		for (auto it = container.begin(); it; ++it)
+		{
+			ASSERT_EQ(*it, expected++);
+		}
+		ASSERT_EQ(expected, size - 1);
+
+		for (uint32_t i = 1; i < size; ++i)
+		{
+			bool found = false;
+			for (auto it = container.find(i * 7919); it; ++it)
+			{
+				found |= *it == mapping[size - 1 - i];
+			}
+			ASSERT_TRUE(found);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, export_sorted_and_buckets)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i * 2654435761u, i);
+		}
+
+		const auto table = container.exportBuckets();
+		ASSERT_EQ(table.offsets.size(), static_cast<size_t>(container.buckets()) + 1);
+		ASSERT_EQ(table.offsets.back(), size);
+		ASSERT_EQ(table.values.size(), size);
+		for (typename TypeParam::sizeType bucket = 0; bucket < container.buckets(); ++bucket)
+		{
+			auto offset = table.offsets[bucket];
+			for (auto it = container.localBegin(bucket); it != container.localEnd(); ++it)
+			{
+				ASSERT_EQ(table.values[offset++], *it);
+			}
+			ASSERT_EQ(offset, table.offsets[bucket + 1]);
+		}
+
+		const auto entries = container.exportSorted();
+		ASSERT_EQ(entries.size(), size);
+		std::vector<bool> seen(size, false);
+		for (typename TypeParam::sizeType bucket = 0; bucket < container.buckets(); ++bucket)
+		{
+			for (auto i = table.offsets[bucket]; i < table.offsets[bucket + 1]; ++i)
+			{
+				ASSERT_EQ(entries[i].hash, container.hash(entries[i].value));
+				if (i > table.offsets[bucket])
+				{
+					ASSERT_TRUE(entries[i - 1] < entries[i]);
+				}
+				seen[entries[i].value] = true;
+			}
+		}
+		ASSERT_EQ(std::count(seen.begin(), seen.end(), true), size);
+
+		// Chains of the self organizing mode are reordered by find, but the export stays the same.
+		container.setSelfOrganizing(true);
+		for (uint32_t i = size; i-- > 0;)
+		{
+			container.find(i * 2654435761u);
+		}
+		const auto organized = container.exportSorted();
+		ASSERT_EQ(organized.size(), size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			ASSERT_EQ(organized[i].hash, entries[i].hash);
+			ASSERT_EQ(organized[i].value, entries[i].value);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, for_each)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i * 2654435761u, i);
+		}
+
+		std::vector<typename TypeParam::sizeType> expected;
+		for (auto it = container.begin(); it; ++it)
+		{
+			expected.push_back(*it);
+		}
+
+		std::vector<typename TypeParam::sizeType> visited;
+		container.forEach([&](typename TypeParam::sizeType value) { visited.push_back(value); });
+		ASSERT_EQ(visited, expected);
+
+		visited.clear();
+		typename TypeParam::sizeType lastBucket = 0;
+		container.forEachBucket([&](typename TypeParam::sizeType bucket, typename TypeParam::LocalIterator it)
+		{
+			ASSERT_TRUE(visited.empty() || bucket > lastBucket);
+			ASSERT_TRUE(it);
+			lastBucket = bucket;
+			for (; it; ++it)
+			{
+				visited.push_back(*it);
+			}
+		});
+		ASSERT_EQ(visited, expected);
+	}
+}
+
+TYPED_TEST(HashContainer_test, partitions_and_parallel_for_each)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i * 2654435761u, i);
+		}
+
+		const auto ranges = container.partitions(4);
+		ASSERT_EQ(ranges.size(), 4u);
+		ASSERT_EQ(ranges.front().begin, 0);
+		ASSERT_EQ(ranges.back().end, container.buckets());
+		std::vector<std::atomic<int>> visits(size);
+		for (size_t i = 0; i < ranges.size(); ++i)
+		{
+			if (i != 0)
+			{
+				ASSERT_EQ(ranges[i - 1].end, ranges[i].begin);
+			}
+			container.forEach(ranges[i], [&](typename TypeParam::sizeType value) { ++visits[value]; });
+		}
+		for (auto &visit : visits)
+		{
+			ASSERT_EQ(visit.exchange(0), 1);
+		}
+
+		container.parallelForEach(4, [&](typename TypeParam::sizeType value) { ++visits[value]; });
+		for (auto &visit : visits)
+		{
+			ASSERT_EQ(visit.exchange(0), 1);
+		}
+
+		size_t taskCount = 0;
+		container.parallelForEach(3, [&](typename TypeParam::sizeType value) { ++visits[value]; }, [&](std::vector<std::function<void()>> &tasks)
+		{
+			taskCount = tasks.size();
+			for (auto &task : tasks)
+			{
+				task();
+			}
+		});
+		ASSERT_GE(taskCount, 1u);
+		ASSERT_LE(taskCount, 3u);
+		for (auto &visit : visits)
+		{
+			ASSERT_EQ(visit.exchange(0), 1);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, partitions_follow_modifications)
+{
+	// The boundaries are placed behind the bucket whose entries reach the next share of all entries.
+	auto expected = [](const TypeParam &container, size_t count)
+	{
+		std::vector<size_t> occupancy(container.buckets(), 0);
+		size_t total = 0;
+		for (typename TypeParam::sizeType bucket = 0; bucket < container.buckets(); ++bucket)
+		{
+			for (auto it = container.localBegin(bucket); it; ++it)
+			{
+				++occupancy[bucket];
+				++total;
+			}
+		}
+
+		std::vector<typename TypeParam::sizeType> ends;
+		size_t end = 0;
+		size_t visited = 0;
+		for (size_t range = 1; range < count; ++range)
+		{
+			while (end < occupancy.size() && visited < total * range / count)
+			{
+				visited += occupancy[end++];
+			}
+			ends.push_back(static_cast<typename TypeParam::sizeType>(end));
+		}
+		ends.push_back(container.buckets());
+		return ends;
+	};
+	auto check = [&expected](const TypeParam &container)
+	{
+		for (size_t count : { 1, 3, 8 })
+		{
+			const auto ranges = container.partitions(count);
+			const auto ends = expected(container, count);
+			ASSERT_EQ(ranges.size(), ends.size());
+			for (size_t i = 0; i < ranges.size(); ++i)
+			{
+				ASSERT_EQ(ranges[i].end, ends[i]);
+			}
+		}
+	};
+
+	for (auto size : sizes)
+	{
+		// Few buckets hold all entries, so most blocks of buckets are empty.
+		TypeParam container(size, TypeParam::TwoChoices);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i % 5 * 2654435761u, i);
+		}
+		check(container);
+
+		for (uint32_t i = 0; i < size; i += 3)
+		{
+			container.remove(i % 5 * 2654435761u, i);
+		}
+		check(container);
+
+		for (auto it = container.find(2654435761u); it;)
+		{
+			it = container.erase(it);
+		}
+		container.removeIf([](typename TypeParam::sizeType value) { return value % 7 == 0; });
+		check(container);
+
+		std::stringstream stream;
+		container.save(stream);
+		check(TypeParam::load(stream));
+		check(TypeParam(container));
+
+		container.clear();
+		check(container);
+	}
+}
+
+TYPED_TEST(HashContainer_test, for_each_value)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i * 2654435761u, i);
+		}
+		container.removeIf([](typename TypeParam::sizeType value) { return value % 3 == 1; });
+
+		auto check = [size](TypeParam &checked)
+		{
+			std::vector<typename TypeParam::sizeType> visited;
+			checked.forEachValue([&](typename TypeParam::sizeType value, typename TypeParam::hashType hash)
+			{
+				ASSERT_EQ(hash, checked.hash(value));
+				visited.push_back(value);
+			});
+
+			std::vector<typename TypeParam::sizeType> expected;
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				if (i % 3 != 1)
+				{
+					expected.push_back(static_cast<typename TypeParam::sizeType>(i));
+				}
+			}
+			ASSERT_EQ(visited, expected);
+		};
+		check(container);
+
+		std::stringstream stream;
+		container.save(stream);
+		TypeParam loaded = TypeParam::load(stream);
+		check(loaded);
+
+		container.clear();
+		container.forEachValue([](typename TypeParam::sizeType, typename TypeParam::hashType) { FAIL(); });
+	}
+}
+
+TYPED_TEST(HashContainer_test, for_each_group)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		// Interleave the hashes, so equal hashes are inserted apart from each other.
+		const uint32_t distinct = static_cast<uint32_t>((size + 2) / 3);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i % distinct, i);
+		}
+
+		std::vector<bool> seen(distinct, false);
+		size_t total = 0;
+		container.forEachGroup([&](typename TypeParam::sizeType bucket, typename TypeParam::hashType hash, const typename TypeParam::sizeType *values, size_t count)
+		{
+			ASSERT_EQ(bucket, values[0] % distinct % container.buckets());
+			const uint32_t key = values[0] % distinct;
+			ASSERT_FALSE(seen[key]);
+			seen[key] = true;
+			for (size_t i = 0; i < count; ++i)
+			{
+				ASSERT_EQ(values[i] % distinct, key);
+				ASSERT_EQ(container.hash(values[i]), hash);
+			}
+
+			// Values of the same hash are sorted like in a SearchIterator.
+			for (size_t i = 1; i < count; ++i)
+			{
+				ASSERT_LT(values[i - 1], values[i]);
+			}
+			total += count;
+		});
+		ASSERT_EQ(total, size);
+		ASSERT_EQ(std::count(seen.begin(), seen.end(), true), distinct);
+	}
+}
+
+TYPED_TEST(HashContainer_test, chains_are_sorted)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i * 2654435761u * 40503u, i);
+		}
+
+		for (typename TypeParam::sizeType bucket = 0; bucket < container.buckets(); ++bucket)
+		{
+			auto it = container.localBegin(bucket);
+			if (!it)
+			{
+				continue;
+			}
+			for (auto previous = *it; ++it; previous = *it)
+			{
+				ASSERT_LE(container.hash(previous), container.hash(*it));
+				ASSERT_TRUE(container.hash(previous) != container.hash(*it) || previous < *it);
+			}
+		}
+
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			bool found = false;
+			for (auto it = container.find(i * 2654435761u * 40503u); it; ++it)
+			{
+				found |= *it == i;
+			}
+			ASSERT_TRUE(found);
+		}
+
+		for (uint32_t i = 0; i < size; i += 2)
+		{
+			container.remove(i * 2654435761u * 40503u, i);
+		}
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			bool found = false;
+			for (auto it = container.find(i * 2654435761u * 40503u); it; ++it)
+			{
+				found |= *it == i;
+			}
+			ASSERT_EQ(found, i % 2 == 1);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, self_organizing_find)
+{
+	for (auto size : sizes)
+	{
+		// Only the highest byte differs, so most containers store every entry inside one chain.
+		auto hashOf = [](uint32_t i) { return static_cast<size_t>(i) << (sizeof(size_t) * 8 - 8); };
+		TypeParam container(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(hashOf(i), i);
+		}
+
+		container.setSelfOrganizing(true, 2);
+		ASSERT_TRUE(container.selfOrganizing());
+
+		// The second search moves the entry to the front.
+		const uint32_t hot = static_cast<uint32_t>(size - 1);
+		ASSERT_EQ(*container.find(hashOf(hot)), hot);
+		ASSERT_EQ(*container.find(hashOf(hot)), hot);
+		const auto bucket = static_cast<typename TypeParam::sizeType>(static_cast<typename TypeParam::sizeType>(hashOf(hot)) % container.buckets());
+		ASSERT_EQ(*container.localBegin(bucket), hot);
+
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			ASSERT_EQ(*container.find(hashOf(i)), i);
+		}
+		container.remove(hashOf(hot), hot);
+		container.insert(hashOf(hot + 1), hot);
+		ASSERT_EQ(*container.find(hashOf(hot + 1)), hot);
+
+		container.setSelfOrganizing(false);
+		ASSERT_FALSE(container.selfOrganizing());
+		for (uint32_t i = 0; i < hot; ++i)
+		{
+			ASSERT_EQ(*container.find(hashOf(i)), i);
+		}
+		ASSERT_EQ(*container.find(hashOf(hot + 1)), hot);
+		ASSERT_FALSE(container.find(hashOf(hot)));
+	}
+}
+
+TYPED_TEST(HashContainer_test, self_organizing_keeps_runs_together)
+{
+	auto hashOf = [](uint32_t i) { return static_cast<size_t>(i) << (sizeof(size_t) * 8 - 8); };
+	TypeParam container(3, 1);
+	container.insert(hashOf(5), 0);
+	container.insert(hashOf(5), 1);
+	container.insert(hashOf(9), 2);
+	container.setSelfOrganizing(true);
+
+	// Matching the second node of the run of 5 moves the whole run in front of 9.
+	ASSERT_EQ(*container.find(hashOf(9)), 2);
+	auto it = container.findIf(hashOf(5), [](typename TypeParam::sizeType value) { return value == 1; });
+	ASSERT_EQ(*it, 1);
+
+	std::vector<typename TypeParam::sizeType> chain;
+	for (auto local = container.localBegin(0); local; ++local)
+	{
+		chain.push_back(*local);
+	}
+	ASSERT_EQ(chain, (std::vector<typename TypeParam::sizeType>{ 0, 1, 2 }));
+
+	size_t groups = 0;
+	container.forEachGroup([&](typename TypeParam::sizeType, typename TypeParam::hashType, const typename TypeParam::sizeType *, size_t) { ++groups; });
+	ASSERT_EQ(groups, 2u);
+
+	// The Iterator still knows the node linking to the match.
+	container.erase(it);
+	ASSERT_EQ(*container.localBegin(0), 0);
+	ASSERT_FALSE(container.findIf(hashOf(5), [](typename TypeParam::sizeType value) { return value == 1; }));
+	ASSERT_EQ(*container.find(hashOf(9)), 2);
+}
+
+TYPED_TEST(HashContainer_test, long_chains_stay_consistent)
+{
+	for (auto size : sizes)
+	{
+		// Only the highest byte differs and every third hash is shared, so most containers store everything inside one long chain.
+		auto hashOf = [](uint32_t i) { return static_cast<size_t>(i / 3 * 3 % 251) << (sizeof(size_t) * 8 - 8); };
+		TypeParam container(size);
+		std::vector<bool> used(size, false);
+		auto check = [&]()
+		{
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				bool found = false;
+				for (auto it = container.find(hashOf(i)); it; ++it)
+				{
+					ASSERT_TRUE(!used[i] || container.hash(*it) == container.hash(i));
+					found |= *it == i;
+				}
+				ASSERT_EQ(found, used[i]);
+				ASSERT_EQ(static_cast<bool>(container.findIf(hashOf(i), [i](typename TypeParam::sizeType value) { return value == i; })), used[i]);
+			}
+			ASSERT_FALSE(container.find(static_cast<size_t>(252) << (sizeof(size_t) * 8 - 8)));
+
+			// Indexed chains are sorted by hash and value like all others.
+			for (typename TypeParam::sizeType bucket = 0; bucket < container.buckets(); ++bucket)
+			{
+				std::vector<typename TypeParam::Entry> entries;
+				for (auto it = container.localBegin(bucket); it; ++it)
+				{
+					entries.push_back({ container.hash(*it), *it });
+				}
+				ASSERT_TRUE(std::is_sorted(entries.begin(), entries.end()));
+			}
+		};
+
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(hashOf(i), i);
+			used[i] = true;
+		}
+		check();
+
+		for (uint32_t i = 0; i < size; i += 4)
+		{
+			container.remove(hashOf(i), i);
+			used[i] = false;
+		}
+		check();
+
+		for (uint32_t i = 1; i < size; i += 4)
+		{
+			for (auto it = container.find(hashOf(i)); it; ++it)
+			{
+				if (*it == i)
+				{
+					container.erase(it);
+					break;
+				}
+			}
+			used[i] = false;
+		}
+		check();
+
+		for (uint32_t i = 0; i < size; i += 4)
+		{
+			container.insert(hashOf(i), i);
+			used[i] = true;
+		}
+		check();
+
+		container.removeIf([](typename TypeParam::sizeType value) { return value % 4 == 2; });
+		for (uint32_t i = 2; i < size; i += 4)
+		{
+			used[i] = false;
+		}
+		check();
+
+		container.clear();
+		std::fill(used.begin(), used.end(), false);
+		check();
+	}
+}
+
+TYPED_TEST(HashContainer_test, two_choices)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size, TypeParam::TwoChoices);
+		ASSERT_EQ(container.bucketChoice(), TypeParam::TwoChoices);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(i * 2654435761u / 3, i);
+		}
+
+		auto check = [size](const TypeParam &checked, uint32_t removed)
+		{
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				bool found = false;
+				for (auto it = checked.find(i * 2654435761u / 3); it; ++it)
+				{
+					found |= *it == i;
+				}
+				ASSERT_EQ(found, i % 3 != removed);
+				ASSERT_EQ(static_cast<bool>(checked.findIf(i * 2654435761u / 3, [i](typename TypeParam::sizeType value) { return value == i; })), i % 3 != removed);
+			}
+		};
+		check(container, 3);
+
+		for (uint32_t i = 0; i < size; i += 3)
+		{
+			container.remove(i * 2654435761u / 3, i);
+		}
+		check(container, 0);
+
+		std::stringstream stream;
+		container.save(stream);
+		TypeParam loaded = TypeParam::load(stream);
+		ASSERT_EQ(loaded.bucketChoice(), TypeParam::TwoChoices);
+		check(loaded, 0);
+
+		// Erasing through the iterator continues with the second bucket.
+		for (uint32_t i = 1; i < size; i += 3)
+		{
+			for (auto it = loaded.find(i * 2654435761u / 3); it;)
+			{
+				it = *it == i ? loaded.erase(it) : ++it;
+			}
+		}
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			ASSERT_EQ(static_cast<bool>(loaded.findIf(i * 2654435761u / 3, [i](typename TypeParam::sizeType value) { return value == i; })), i % 3 == 2);
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, two_choices_with_equal_hashes)
+{
+	for (auto size : sizes)
+	{
+		TypeParam container(size, TypeParam::TwoChoices);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(7, i);
+		}
+
+		auto it = container.find(7);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			ASSERT_EQ(*it, i);
+			++it;
+		}
+		ASSERT_FALSE(it);
+	}
+}
+
+TYPED_TEST(HashContainer_test, prefetch_does_not_modify)
+{
+	for (auto size : sizes)
+	{
+		for (auto choice : { TypeParam::SingleChoice, TypeParam::TwoChoices })
+		{
+			TypeParam container(size, choice);
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				container.prefetch(i);
+				container.insert(i, i);
+			}
+
+			// Pipeline the lookups by prefetching a few hashes ahead.
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				container.prefetch(i + 4);
+				container.prefetchNode(i);
+				bool found = false;
+				for (auto it = container.find(i); it; ++it)
+				{
+					found |= *it == i;
+				}
+				ASSERT_TRUE(found);
+			}
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, prefetching_iterators)
+{
+	for (auto size : sizes)
+	{
+		for (auto choice : { TypeParam::SingleChoice, TypeParam::TwoChoices })
+		{
+			TypeParam container(size, choice);
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				container.insert(i % 3, i);
+			}
+
+			for (typename TypeParam::sizeType distance : { 0, 1, 3, 200 })
+			{
+				std::vector<typename TypeParam::sizeType> expected;
+				for (auto it = container.begin(); it != container.end(); ++it)
+				{
+					expected.push_back(*it);
+				}
+				std::vector<typename TypeParam::sizeType> visited;
+				for (typename TypeParam::PrefetchingIterator it(container.begin(), distance); it != container.end(); ++it)
+				{
+					visited.push_back(*it);
+				}
+				ASSERT_EQ(visited, expected);
+
+				for (uint32_t hash = 0; hash < 4; ++hash)
+				{
+					expected.clear();
+					for (auto it = container.find(hash); it; ++it)
+					{
+						expected.push_back(*it);
+					}
+					visited.clear();
+					for (typename TypeParam::PrefetchingSearchIterator it(container.find(hash), distance); it; ++it)
+					{
+						visited.push_back(*it);
+					}
+					ASSERT_EQ(visited, expected);
+				}
+			}
+		}
+	}
+}
+
+TYPED_TEST(HashContainer_test, custom_bucket_count)
+{
+	for (auto size : sizes)
+	{
+		for (size_t buckets : { size_t(1), size / 2 + 1, std::min<size_t>(size * 3, TypeParam::sizeLimits::max()) })
+		{
+			TypeParam container(size, buckets);
+			ASSERT_EQ(container.buckets(), buckets);
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				container.insert(i * 2654435761u, i);
+			}
+
+			std::stringstream stream;
+			container.save(stream);
+			TypeParam loaded = TypeParam::load(stream);
+			ASSERT_EQ(loaded.buckets(), buckets);
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				ASSERT_TRUE(loaded.findIf(i * 2654435761u, [i](typename TypeParam::sizeType value) { return value == i; }));
+			}
+		}
+	}
+
+	ASSERT_THROW(TypeParam(10, 0), std::runtime_error);
+	ASSERT_THROW(TypeParam(10, static_cast<size_t>(TypeParam::sizeLimits::max()) + 1), std::runtime_error);
+	ASSERT_NO_THROW(TypeParam(0, 0));
+}
+
+TEST(HashContainer_test, long_run_of_one_hash)
+{
+	// Every entry shares one hash, so inserting into the indexed chain must not walk the run of the hash.
+	const uint32_t size = 100000;
+	HashContainer container(size, HashContainer::TwoChoices);
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		container.insert(42, (i * 7919u) % size);
+	}
+	for (uint32_t i = 0; i < size; i += 2)
+	{
+		container.remove(42, i);
+	}
+
+	uint32_t expected = 1;
+	for (auto it = container.find(42); it; ++it)
+	{
+		ASSERT_EQ(*it, expected);
+		expected += 2;
+	}
+	ASSERT_EQ(expected, size + 1);
+}
+
+TEST(HashContainer_test, two_choices_bound_chain_length)
+{
+	// Fill one entry per bucket with well mixed hashes.
+	const uint32_t size = 200000;
+	auto hashOf = [](uint64_t i)
+	{
+		i = (i ^ (i >> 30)) * 0xbf58476d1ce4e5b9ull;
+		i = (i ^ (i >> 27)) * 0x94d049bb133111ebull;
+		return static_cast<size_t>(i ^ (i >> 31));
+	};
+	auto longestChain = [&](HashContainer::BucketChoice choice)
+	{
+		HashContainer container(size, size, choice);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			container.insert(hashOf(i), i);
+		}
+
+		size_t longest = 0;
+		for (HashContainer::sizeType bucket = 0; bucket < container.buckets(); ++bucket)
+		{
+			size_t length = 0;
+			for (auto it = container.localBegin(bucket); it; ++it)
+			{
+				++length;
+			}
+			longest = std::max(longest, length);
+		}
+		return longest;
+	};
+
+	// Two choices keep the longest chain at O(log log n), one choice lets it grow like O(log n / log log n).
+	const size_t single = longestChain(HashContainer::SingleChoice);
+	const size_t two = longestChain(HashContainer::TwoChoices);
+	ASSERT_LE(two, 4u);
+	ASSERT_GE(single, two + 3);
+}
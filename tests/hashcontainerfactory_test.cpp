@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+
+#include <hashcontainerfactory.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+	// The arrays of a container are allocated with new[], so counting those allocations measures its real size.
+	bool countArrays = false;
+	size_t arrayBytes = 0;
+
+	template<class Container>
+	uint64_t allocatedBytes(size_t entries, size_t buckets)
+	{
+		arrayBytes = 0;
+		countArrays = true;
+		Container container(entries, buckets);
+		countArrays = false;
+		return arrayBytes;
+	}
+}
+
+void *operator new[](size_t size)
+{
+	if (countArrays)
+	{
+		arrayBytes += size;
+	}
+	if (void *pointer = std::malloc(size != 0 ? size : 1))
+	{
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete[](void *pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+TEST(HashContainerFactory_test, layout_matches_containers)
+{
+	ASSERT_EQ(HashContainerLayout::nodeBytes(1, 1), sizeof(GenericHashContainer<uint8_t, uint8_t>::Node));
+	ASSERT_EQ(HashContainerLayout::nodeBytes(1, 4), sizeof(GenericHashContainer<uint8_t, uint32_t>::Node));
+	ASSERT_EQ(HashContainerLayout::nodeBytes(2, 1), sizeof(GenericHashContainer<uint16_t, uint8_t>::Node));
+	ASSERT_EQ(HashContainerLayout::nodeBytes(4, 2), sizeof(GenericHashContainer<uint32_t, uint16_t>::Node));
+	ASSERT_EQ(HashContainerLayout::nodeBytes(8, 1), sizeof(GenericHashContainer<uint64_t, uint8_t>::Node));
+
+	// The largest capacity of every sizeType is accepted, the next one is rejected.
+	using Tiny = GenericHashContainer<uint8_t, uint8_t>;
+	ASSERT_EQ(HashContainerLayout::sizeTypeBytes(Tiny::maximumEntries), 1u);
+	ASSERT_EQ(HashContainerLayout::sizeTypeBytes(Tiny::maximumEntries + 1), 2u);
+	ASSERT_EQ(HashContainerLayout::sizeTypeBytes(GenericHashContainer<uint16_t, uint8_t>::maximumEntries + 1), 4u);
+	ASSERT_EQ(HashContainerLayout::sizeTypeBytes(GenericHashContainer<uint32_t, uint8_t>::maximumEntries + 1), 8u);
+	ASSERT_NO_THROW(Tiny(Tiny::maximumEntries));
+	ASSERT_THROW(Tiny(Tiny::maximumEntries + 1), std::runtime_error);
+}
+
+TEST(HashContainerFactory_test, select_at_compile_time)
+{
+	static_assert(std::is_same<AutoHashContainer<100, 256>, GenericHashContainer<uint8_t, uint8_t>>::value, "");
+	static_assert(std::is_same<AutoHashContainer<100, 1000>, GenericHashContainer<uint8_t, uint16_t>>::value, "");
+	static_assert(std::is_same<AutoHashContainer<1000, 256>, GenericHashContainer<uint16_t, uint16_t>>::value, "");
+	static_assert(std::is_same<AutoHashContainer<1000, 1000000>, GenericHashContainer<uint16_t, uint32_t>>::value, "");
+	// The hash fills the padding of the Node.
+	static_assert(std::is_same<AutoHashContainer<1000000>, HashContainer>::value, "");
+	static_assert(std::is_same<AutoHashContainer<10000000000ull, 2>, GenericHashContainer<uint64_t, uint32_t>>::value, "");
+
+	AutoHashContainer<1000> container(1000);
+	container.insert(42, 7);
+	ASSERT_EQ(*container.find(42), 7u);
+}
+
+TEST(HashContainerFactory_test, select_at_runtime)
+{
+	const std::vector<size_t> sizes = { 1, 100, 1000, 1000000 };
+	for (size_t size : sizes)
+	{
+		for (double rate : { 0.5, 1e-3, 1e-6 })
+		{
+			AnyHashContainer container = AnyHashContainer::create(size, rate);
+			ASSERT_EQ(container.nodes(), size);
+			ASSERT_EQ(container.sizeTypeBytes(), HashContainerLayout::sizeTypeBytes(size));
+			ASSERT_LE(1.0 / (HashContainer::bucketFactor << (container.hashTypeBytes() * 8)), rate);
+		}
+	}
+
+	using Tiny = GenericHashContainer<uint8_t, uint8_t>;
+	ASSERT_NE(AnyHashContainer::create(100, 1.0 / 256).target<Tiny>(), nullptr);
+	ASSERT_EQ(AnyHashContainer::create(100, 1.0 / 256).target<HashContainer>(), nullptr);
+	ASSERT_THROW(AnyHashContainer::create(100, 1e-12), std::runtime_error);
+	ASSERT_THROW(AnyHashContainer::create(100, 0), std::runtime_error);
+}
+
+TEST(HashContainerFactory_test, handle_forwards_to_container)
+{
+	AnyHashContainer container = AnyHashContainer::create(100);
+	for (size_t i = 0; i < 50; ++i)
+	{
+		container.insert(i * 2654435761u, i);
+	}
+
+	for (size_t i = 0; i < 50; ++i)
+	{
+		bool found = false;
+		container.find(i * 2654435761u, [&found, i](size_t value) { found |= value == i; });
+		ASSERT_TRUE(found);
+		ASSERT_TRUE(container.contains(i * 2654435761u, i));
+	}
+
+	AnyHashContainer copy = container;
+	container.remove(0, 0);
+	ASSERT_FALSE(container.contains(0, 0));
+	ASSERT_TRUE(copy.contains(0, 0));
+
+	std::stringstream stream;
+	copy.save(stream);
+	using Container = GenericHashContainer<uint8_t, uint16_t>;
+	Container loaded = Container::load(stream);
+	ASSERT_TRUE(loaded.findIf(0, [](Container::sizeType value) { return value == 0; }));
+
+	container.clear();
+	ASSERT_FALSE(container.contains(7, 7));
+	for (size_t i = 0; i < 100; ++i)
+	{
+		ASSERT_EQ(container.insert(i), i);
+	}
+	ASSERT_EQ(container.insert(7), std::numeric_limits<size_t>::max());
+	ASSERT_TRUE(container.contains(7, 7));
+}
+
+TEST(HashContainerFactory_test, fit_budget)
+{
+	for (uint64_t budget : { 64u, 1000u, 100000u, 1000000u })
+	{
+		for (uint64_t inverseRate : { 2u, 1000u, 65536u, 100000000u })
+		{
+			const HashContainerShape shape = HashContainerLayout::fitBudget(budget, inverseRate);
+			ASSERT_GT(shape.entries, 0u);
+			ASSERT_LE(HashContainerLayout::bytes(shape), budget);
+			ASSERT_GE(shape.buckets, shape.entries);
+			ASSERT_LE(static_cast<double>(shape.entries) / shape.buckets / std::ldexp(1.0, static_cast<int>(shape.hashTypeBytes * 8)), 1.0 / inverseRate);
+
+			// Another entry of the same types does not fit anymore, unless the entries are limited by sizeType.
+			HashContainerShape larger = shape;
+			++larger.entries;
+			larger.buckets = std::max(larger.buckets, larger.entries);
+			if (static_cast<double>(shape.buckets) * 2 < std::ldexp(1.0, static_cast<int>(shape.sizeTypeBytes * 8)))
+			{
+				ASSERT_GT(HashContainerLayout::bytes(larger), budget);
+			}
+		}
+	}
+
+	// A bucket factor of 1 and a hash that fills the padding of the Node beat the default layout.
+	const HashContainerShape shape = HashContainerLayout::fitBudget(1000000, 65536);
+	ASSERT_EQ(shape.sizeTypeBytes, 4u);
+	ASSERT_EQ(shape.hashTypeBytes, 4u);
+	ASSERT_EQ(shape.buckets, shape.entries);
+	ASSERT_GT(shape.entries, 1000000u / 17);
+
+	const HashContainerShape spacious = HashContainerLayout::fitBudget(1000000, 65536, 2);
+	ASSERT_EQ(spacious.buckets, spacious.entries * 2);
+	ASSERT_EQ(HashContainerLayout::fitBudget(1, 2).entries, 0u);
+}
+
+TEST(HashContainerFactory_test, bytes_match_allocation)
+{
+	// Bucket counts that are not a multiple of the occupancy block size round the occupancy counters up.
+	for (size_t buckets : { 1u, 63u, 64u, 65u, 200u })
+	{
+		const size_t entries = std::min<size_t>(buckets, 100);
+		ASSERT_EQ((HashContainerLayout::bytes({ 1, 1, entries, buckets })), (allocatedBytes<GenericHashContainer<uint8_t, uint8_t>>(entries, buckets)));
+		ASSERT_EQ((HashContainerLayout::bytes({ 2, 4, entries, buckets })), (allocatedBytes<GenericHashContainer<uint16_t, uint32_t>>(entries, buckets)));
+		ASSERT_EQ((HashContainerLayout::bytes({ 4, 2, entries, buckets })), (allocatedBytes<GenericHashContainer<uint32_t, uint16_t>>(entries, buckets)));
+		ASSERT_EQ((HashContainerLayout::bytes({ 8, 1, entries, buckets })), (allocatedBytes<GenericHashContainer<uint64_t, uint8_t>>(entries, buckets)));
+	}
+
+	// A container of a fitted shape stays within the budget.
+	const HashContainerShape shape = HashContainerLayout::fitBudget(100000, 1000);
+	ASSERT_EQ(shape.sizeTypeBytes, 2u);
+	ASSERT_EQ(shape.hashTypeBytes, 2u);
+	ASSERT_LE((allocatedBytes<GenericHashContainer<uint16_t, uint16_t>>(shape.entries, shape.buckets)), 100000u);
+	ASSERT_EQ(HashContainerLayout::bytes(shape), (allocatedBytes<GenericHashContainer<uint16_t, uint16_t>>(shape.entries, shape.buckets)));
+}
+
+TEST(HashContainerFactory_test, create_for_budget)
+{
+	AnyHashContainer container = AnyHashContainer::createForBudget(100000, 1e-3);
+	ASSERT_LE(container.bytes(), 100000u);
+	ASSERT_GT(container.bytes(), 90000u);
+	for (size_t i = 0; i < container.nodes(); ++i)
+	{
+		container.insert(i * 2654435761u, i);
+	}
+	for (size_t i = 0; i < container.nodes(); ++i)
+	{
+		ASSERT_TRUE(container.contains(i * 2654435761u, i));
+	}
+
+	ASSERT_THROW(AnyHashContainer::createForBudget(1), std::runtime_error);
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+
+#include <hashcontainerjournal.h>
+
+#include <cstdio>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct HashContainerJournal_test : testing::Test
+{
+	const std::string snapshotPath = "hashcontainerjournal_test.snapshot";
+	const std::string journalPath = "hashcontainerjournal_test.journal";
+
+	void SetUp() override
+	{
+		TearDown();
+	}
+
+	void TearDown() override
+	{
+		std::remove(snapshotPath.c_str());
+		std::remove(journalPath.c_str());
+	}
+};
+
+TEST_F(HashContainerJournal_test, recover_committed_records)
+{
+	{
+		HashContainer container(100);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 8);
+		for (uint32_t i = 0; i < 100; ++i)
+		{
+			journal.insert(i, i);
+		}
+		for (uint32_t i = 0; i < 100; i += 2)
+		{
+			journal.remove(i, i);
+		}
+	}
+
+	HashContainer recovered = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath);
+	for (uint32_t i = 0; i < 100; ++i)
+	{
+		ASSERT_EQ(static_cast<bool>(recovered.find(i)), i % 2 == 1);
+	}
+}
+
+TEST_F(HashContainerJournal_test, recover_after_checkpoint)
+{
+	{
+		HashContainer container(100);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 4, 10);
+		for (uint32_t i = 0; i < 50; ++i)
+		{
+			journal.insert(i, i);
+		}
+		journal.clear();
+		for (uint32_t i = 0; i < 25; ++i)
+		{
+			journal.insert(i, i);
+		}
+	}
+
+	HashContainer recovered = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath);
+	for (uint32_t i = 0; i < 50; ++i)
+	{
+		ASSERT_EQ(static_cast<bool>(recovered.find(i)), i < 25);
+	}
+}
+
+TEST_F(HashContainerJournal_test, continue_after_recover)
+{
+	{
+		HashContainer container(10);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 1);
+		journal.insert(1, 1);
+	}
+
+	{
+		HashContainer container = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 1);
+		journal.insert(2, 2);
+	}
+
+	HashContainer recovered = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath);
+	ASSERT_TRUE(recovered.find(1));
+	ASSERT_TRUE(recovered.find(2));
+	ASSERT_FALSE(recovered.find(3));
+}
+
+TEST_F(HashContainerJournal_test, ignore_torn_record)
+{
+	{
+		HashContainer container(10);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 1);
+		journal.insert(1, 1);
+	}
+
+	{
+		std::ofstream journal(journalPath, std::ios::binary | std::ios::app);
+		const char torn[] = { 0, 2, 0 };
+		journal.write(torn, sizeof(torn));
+	}
+
+	HashContainer recovered = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath);
+	ASSERT_TRUE(recovered.find(1));
+	ASSERT_FALSE(recovered.find(2));
+}
+
+TEST_F(HashContainerJournal_test, recover_missing_snapshot_throw)
+{
+	EXPECT_THROW(HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath), std::runtime_error);
+}
+
+TEST_F(HashContainerJournal_test, replay_chosen_values)
+{
+	{
+		HashContainer container(10);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 1);
+		journal.insert(100);
+		journal.insert(101);
+		journal.checkpoint();
+		journal.remove(100, 0);
+		journal.insert(102);
+	}
+
+	HashContainer recovered = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath);
+	ASSERT_EQ(*recovered.find(101), 1);
+	ASSERT_EQ(*recovered.find(102), 0);
+	ASSERT_FALSE(recovered.find(100));
+	ASSERT_EQ(recovered.insert(103), 2);
+}
+
+TEST_F(HashContainerJournal_test, continue_after_torn_record)
+{
+	{
+		HashContainer container(10);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 1);
+		journal.insert(1, 1);
+		journal.insert(2, 2);
+	}
+
+	// Cut the last record in half, like a crash during its write would.
+	uint64_t complete;
+	{
+		HashContainer recovered = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath, &complete);
+		ASSERT_EQ(::truncate(journalPath.c_str(), static_cast<off_t>(complete - 3)), 0);
+	}
+
+	uint64_t length;
+	{
+		HashContainer container = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath, &length);
+		ASSERT_EQ(length, complete - (1 + sizeof(uint64_t) + sizeof(uint32_t)));
+		ASSERT_FALSE(container.find(2));
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 1);
+		journal.insert(3, 3);
+		journal.insert(4, 4);
+	}
+
+	HashContainer recovered = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath, &length);
+	ASSERT_EQ(length, complete + (1 + sizeof(uint64_t) + sizeof(uint32_t)));
+	ASSERT_TRUE(recovered.find(1));
+	ASSERT_FALSE(recovered.find(2));
+	ASSERT_TRUE(recovered.find(3));
+	ASSERT_TRUE(recovered.find(4));
+}
+
+TEST_F(HashContainerJournal_test, reject_value_out_of_range)
+{
+	{
+		HashContainer container(10);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 1);
+		journal.insert(1, 1);
+	}
+
+	{
+		std::ofstream journal(journalPath, std::ios::binary | std::ios::app);
+		const uint8_t operation = 0;
+		const uint64_t hash = 5;
+		const uint32_t value = 100000;
+		journal.write(reinterpret_cast<const char *>(&operation), sizeof(operation));
+		journal.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+		journal.write(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+
+	EXPECT_THROW(HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath), std::runtime_error);
+}
+
+TEST_F(HashContainerJournal_test, failed_checkpoint_keeps_records)
+{
+	const std::string temporaryPath = snapshotPath + ".tmp";
+	{
+		HashContainer container(10);
+		HashContainerJournal<HashContainer> journal(container, snapshotPath, journalPath, 8);
+		journal.insert(1, 1);
+
+		// A directory in place of the temporary snapshot makes the checkpoint fail.
+		ASSERT_EQ(::mkdir(temporaryPath.c_str(), 0700), 0);
+		EXPECT_THROW(journal.checkpoint(), std::runtime_error);
+		::rmdir(temporaryPath.c_str());
+	}
+
+	HashContainer recovered = HashContainerJournal<HashContainer>::recover(snapshotPath, journalPath);
+	ASSERT_TRUE(recovered.find(1));
+}
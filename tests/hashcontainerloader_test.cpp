@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <hashcontainerloader.h>
+
+#include <cstdio>
+#include <fstream>
+
+struct HashContainerLoader_test : testing::Test
+{
+	const std::string snapshotPath = "hashcontainerloader_test.snapshot";
+
+	void TearDown() override
+	{
+		std::remove(snapshotPath.c_str());
+	}
+};
+
+TEST_F(HashContainerLoader_test, load_in_chunks)
+{
+	HashContainer container(10000);
+	for (uint32_t i = 0; i < 10000; ++i)
+	{
+		container.insert(i * 2654435761u, i);
+	}
+
+	{
+		std::ofstream stream(snapshotPath, std::ios::binary);
+		const uint64_t prefix = 42;
+		stream.write(reinterpret_cast<const char *>(&prefix), sizeof(prefix));
+		container.save(stream);
+	}
+
+	HashContainerLoader<HashContainer> loader(4, 4096);
+	HashContainer loaded = loader.loadAsync(snapshotPath, sizeof(uint64_t)).get();
+	ASSERT_EQ(loaded.nodes(), container.nodes());
+	for (uint32_t i = 0; i < 10000; ++i)
+	{
+		auto it = loaded.find(i * 2654435761u);
+		ASSERT_TRUE(it);
+		ASSERT_EQ(*it, *container.find(i * 2654435761u));
+	}
+}
+
+TEST_F(HashContainerLoader_test, load_truncated_snapshot_throw)
+{
+	HashContainer container(10000);
+	{
+		std::ofstream stream(snapshotPath, std::ios::binary);
+		container.save(stream);
+	}
+
+	HashContainerLoader<HashContainer> loader(2, 4096);
+	EXPECT_THROW(loader.load(snapshotPath, 1), std::runtime_error);
+	EXPECT_THROW(loader.load("missing.snapshot"), std::runtime_error);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <hashmap.h>
+
+#include <string>
+
+TEST(HashMap_test, emplace_find_erase)
+{
+	HashMap<std::string, int> map(100);
+	for (int i = 0; i < 100; ++i)
+	{
+		auto result = map.emplace(std::to_string(i), i);
+		ASSERT_TRUE(result.second);
+		ASSERT_EQ(*result.first, i);
+	}
+	ASSERT_EQ(map.size(), 100u);
+
+	auto duplicate = map.emplace("7", 0);
+	ASSERT_FALSE(duplicate.second);
+	ASSERT_EQ(*duplicate.first, 7);
+
+	for (int i = 0; i < 100; i += 2)
+	{
+		ASSERT_TRUE(map.erase(std::to_string(i)));
+	}
+	ASSERT_FALSE(map.erase("0"));
+	ASSERT_EQ(map.size(), 50u);
+
+	for (int i = 0; i < 100; ++i)
+	{
+		const int *value = map.find(std::to_string(i));
+		if (i % 2 == 0)
+		{
+			ASSERT_EQ(value, nullptr);
+		}
+		else
+		{
+			ASSERT_NE(value, nullptr);
+			ASSERT_EQ(*value, i);
+		}
+	}
+
+	ASSERT_EQ(map.find("100"), nullptr);
+}
+
+TEST(HashMap_test, full_map_throw)
+{
+	HashMap<int, int> map(2);
+	map.emplace(1, 1);
+	map.emplace(2, 2);
+	EXPECT_THROW(map.emplace(3, 3), std::runtime_error);
+
+	map.erase(1);
+	EXPECT_TRUE(map.emplace(3, 3).second);
+}
+
+TEST(HashMap_test, verify_keys_with_colliding_hashes)
+{
+	struct ConstantHasher
+	{
+		size_t operator()(int) const { return 42; }
+	};
+
+	HashMap<int, int, ConstantHasher> map(10);
+	for (int i = 0; i < 10; ++i)
+	{
+		map.emplace(i, i * 10);
+	}
+
+	for (int i = 0; i < 10; ++i)
+	{
+		ASSERT_EQ(*map.find(i), i * 10);
+	}
+	ASSERT_EQ(map.find(10), nullptr);
+
+	// Keys in the middle of the run of the hash are unlinked without losing the others.
+	for (int i = 1; i < 10; i += 3)
+	{
+		ASSERT_TRUE(map.erase(i));
+		ASSERT_FALSE(map.erase(i));
+	}
+	for (int i = 0; i < 10; ++i)
+	{
+		if (i % 3 == 1)
+		{
+			ASSERT_EQ(map.find(i), nullptr);
+		}
+		else
+		{
+			ASSERT_EQ(*map.find(i), i * 10);
+		}
+	}
+	ASSERT_EQ(map.size(), 7u);
+}
+
+TEST(HashMap_test, copy_and_clear)
+{
+	HashMap<std::string, std::string> map(10);
+	map.emplace("a", "1");
+	map.emplace("b", "2");
+
+	HashMap<std::string, std::string> copy(map);
+	map.clear();
+	ASSERT_EQ(map.size(), 0u);
+	ASSERT_EQ(map.find("a"), nullptr);
+
+	ASSERT_EQ(copy.size(), 2u);
+	ASSERT_EQ(*copy.find("a"), "1");
+	ASSERT_EQ(*copy.find("b"), "2");
+
+	map = std::move(copy);
+	ASSERT_EQ(*map.find("b"), "2");
+}
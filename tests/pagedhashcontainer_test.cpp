@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+
+#include <pagedhashcontainer.h>
+
+#include <cstdio>
+#include <fstream>
+
+template<typename container_t>
+struct PagedHashContainer_test : testing::Test
+{
+	const std::string path = "pagedhashcontainer_test.snapshot";
+
+	void TearDown() override
+	{
+		std::remove(path.c_str());
+	}
+};
+
+using paged_container_ts = ::testing::Types<
+	GenericPagedHashContainer<uint8_t, uint8_t>,
+	GenericPagedHashContainer<uint16_t, uint32_t>,
+	GenericPagedHashContainer<uint32_t, uint16_t>,
+	GenericPagedHashContainer<uint64_t, uint32_t>>;
+TYPED_TEST_CASE(PagedHashContainer_test, paged_container_ts);
+
+TYPED_TEST(PagedHashContainer_test, insert_find_remove_with_small_pool)
+{
+	const size_t size = TypeParam::sizeLimits::max() / 4 < 5000 ? TypeParam::sizeLimits::max() / 4 : 5000;
+	TypeParam container(this->path, size, 2);
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		container.insert(i / 2, i);
+	}
+
+	for (uint32_t i = 0; i < size; i += 2)
+	{
+		auto it = container.find(i / 2);
+		ASSERT_TRUE(it);
+		ASSERT_EQ(*it, i + 1 < size ? i + 1 : i);
+	}
+
+	for (uint32_t i = 0; i < size; i += 2)
+	{
+		container.remove(i / 2, i);
+	}
+
+	for (uint32_t i = 1; i < size; i += 2)
+	{
+		auto it = container.find(i / 2);
+		ASSERT_TRUE(it);
+		ASSERT_EQ(*it, i);
+		ASSERT_FALSE(++it);
+	}
+
+	container.clear();
+	ASSERT_FALSE(container.find(0));
+}
+
+TYPED_TEST(PagedHashContainer_test, open_snapshot_and_load_result)
+{
+	using Container = typename TypeParam::Container;
+
+	{
+		Container container(40);
+		for (uint32_t i = 0; i < 20; ++i)
+		{
+			container.insert(i, i);
+		}
+		std::ofstream stream(this->path, std::ios::binary);
+		container.save(stream);
+	}
+
+	{
+		TypeParam paged(this->path, 1);
+		ASSERT_EQ(paged.nodes(), 40);
+		for (uint32_t i = 0; i < 20; ++i)
+		{
+			ASSERT_EQ(*paged.find(i), i);
+		}
+		for (uint32_t i = 20; i < 40; ++i)
+		{
+			paged.insert(i, i);
+		}
+	}
+
+	std::ifstream stream(this->path, std::ios::binary);
+	Container loaded = Container::load(stream);
+	for (uint32_t i = 0; i < 40; ++i)
+	{
+		ASSERT_EQ(*loaded.find(i), i);
+	}
+}
+
+TYPED_TEST(PagedHashContainer_test, open_missing_file_throw)
+{
+	EXPECT_THROW(TypeParam container("missing.snapshot", 1), std::runtime_error);
+}
+
+TYPED_TEST(PagedHashContainer_test, load_sorts_chains)
+{
+	using Container = typename TypeParam::Container;
+
+	// The paged container prepends nodes, so ascending hashes of one bucket form an unsorted chain.
+	{
+		TypeParam paged(this->path, 20, 1);
+		for (uint32_t i = 0; i < 20; ++i)
+		{
+			paged.insert(3 + (static_cast<size_t>(i) << (sizeof(size_t) * 8 - 8)), i);
+		}
+	}
+
+	std::ifstream stream(this->path, std::ios::binary);
+	Container loaded = Container::load(stream);
+	for (uint32_t i = 0; i < 20; ++i)
+	{
+		ASSERT_EQ(*loaded.find(3 + (static_cast<size_t>(i) << (sizeof(size_t) * 8 - 8))), i);
+	}
+	ASSERT_FALSE(loaded.find(3 + (static_cast<size_t>(20) << (sizeof(size_t) * 8 - 8))));
+}
+
+TYPED_TEST(PagedHashContainer_test, open_two_choices_snapshot_throw)
+{
+	{
+		typename TypeParam::Container container(10, TypeParam::Container::TwoChoices);
+		std::ofstream stream(this->path, std::ios::binary);
+		container.save(stream);
+	}
+
+	EXPECT_THROW(TypeParam container(this->path, 1), std::runtime_error);
+}
+
+TYPED_TEST(PagedHashContainer_test, open_custom_bucket_count)
+{
+	using Container = typename TypeParam::Container;
+
+	{
+		Container container(40, 13);
+		for (uint32_t i = 0; i < 40; ++i)
+		{
+			container.insert(i, i);
+		}
+		std::ofstream stream(this->path, std::ios::binary);
+		container.save(stream);
+	}
+
+	TypeParam paged(this->path, 1);
+	ASSERT_EQ(paged.buckets(), 13);
+	for (uint32_t i = 0; i < 40; ++i)
+	{
+		bool found = false;
+		for (auto it = paged.find(i); it; ++it)
+		{
+			found |= *it == i;
+		}
+		ASSERT_TRUE(found);
+	}
+}
+
+TYPED_TEST(PagedHashContainer_test, open_snapshot_with_free_list_throw)
+{
+	{
+		typename TypeParam::Container container(10);
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			container.insert(i);
+		}
+		container.remove(1, 1);
+		std::ofstream stream(this->path, std::ios::binary);
+		container.save(stream);
+	}
+
+	EXPECT_THROW(TypeParam container(this->path, 1), std::runtime_error);
+}
+
+TYPED_TEST(PagedHashContainer_test, open_truncated_snapshot_throw)
+{
+	{
+		typename TypeParam::Container container(40);
+		for (uint32_t i = 0; i < 20; ++i)
+		{
+			container.insert(i, i);
+		}
+		std::ofstream stream(this->path, std::ios::binary);
+		container.save(stream);
+	}
+
+	std::string bytes;
+	{
+		std::ifstream stream(this->path, std::ios::binary);
+		bytes.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+	{
+		std::ofstream stream(this->path, std::ios::binary | std::ios::trunc);
+		stream.write(bytes.data(), bytes.size() - 1);
+	}
+
+	EXPECT_THROW(TypeParam container(this->path, 1), std::runtime_error);
+}
+
+TEST(PagedHashContainer_test, failed_read_keeps_evicted_page)
+{
+	const std::string path = "pagedhashcontainer_test.snapshot";
+
+	// Entries on the second and third node page, the first one is left free for the insert below.
+	PagedHashContainer::Container container(2000);
+	for (uint32_t i = 600; i < 1100; ++i)
+	{
+		container.insert(i, i);
+	}
+	{
+		std::ofstream stream(path, std::ios::binary);
+		container.save(stream);
+	}
+
+	std::string bytes;
+	{
+		std::ifstream stream(path, std::ios::binary);
+		bytes.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+
+	// Truncate the file in the middle of the second node page after it has been opened.
+	const size_t truncated = sizeof(PagedHashContainer::Container::SnapshotHeader) + sizeof(PagedHashContainer::Bucket) * container.buckets()
+		+ PagedHashContainer::pageSize + 100;
+	{
+		PagedHashContainer paged(path, 1);
+		{
+			std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+			stream.write(bytes.data(), truncated);
+		}
+
+		// The dirty bucket page is evicted by the failing lookup and must not be overwritten afterwards.
+		paged.insert(5, 5);
+		EXPECT_THROW(paged.find(700), std::runtime_error);
+	}
+
+	{
+		std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+		stream.seekp(0, std::ios::end);
+		stream.write(bytes.data() + truncated, bytes.size() - truncated);
+	}
+
+	std::ifstream stream(path, std::ios::binary);
+	PagedHashContainer::Container loaded = PagedHashContainer::Container::load(stream);
+	EXPECT_EQ(*loaded.find(5), 5u);
+	for (uint32_t i = 600; i < 1100; ++i)
+	{
+		ASSERT_EQ(*loaded.find(i), i);
+	}
+	std::remove(path.c_str());
+}